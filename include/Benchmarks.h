@@ -0,0 +1,13 @@
+/*******************************************************************************************************
+On-target benchmarks.  Enabled with RUN_BENCHMARKS in ScaleConfig.h; results go to the serial port.
+Timing uses micros() over enough iterations that its 4us resolution doesn't matter, then converts to
+CPU cycles per iteration.
+*******************************************************************************************************/
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+void benchmarkWeightMath();   // Soft-float vs. fixed-point cost of turning one raw sample into display units
+void benchmarkSettleTime();   // Time-to-stable and still-load jitter, plain moving average vs. the filter chain
+void benchmarkNumberFormat(); // Print's float and integer formatting vs. printFixed() (NumberFormat.h)
+
+#endif
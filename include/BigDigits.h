@@ -0,0 +1,43 @@
+/*******************************************************************************************************
+Large digits for the weight readout.
+
+The weight used to be System5x7 at 2X, which SSD1306Ascii makes by doubling every pixel as it sends
+it - blocky, and hard to read from across the bench.  These are drawn at the size they're shown,
+3 or 4 pages tall (BIG_DIGITS in ScaleConfig.h), and kept in flash as page columns ready to go out
+on the bus.  There are glyphs for 0-9 and '-'; anything else is blank.
+
+A decimal point doesn't get a slot of its own, it goes in the gap at the right of the digit before
+it (a glyph is the character with BIG_POINT set), the way a seven-segment display does it.  So
+every slot is the same width, and "-12.34" is five of them.
+
+DisplayField draws a field of these a slot at a time and sends only the columns that differ from
+the glyph already there, so a digit that changes from 8 to 9 costs a few bytes.
+*******************************************************************************************************/
+#ifndef BIG_DIGITS_H
+#define BIG_DIGITS_H
+
+#include <Arduino.h>
+#include "ScaleConfig.h"
+
+#ifdef BIG_DIGITS
+
+const uint8_t BIG_POINT = 0x80;           // Glyph flag: decimal point after the digit
+
+#if BIG_DIGITS == 3
+const uint8_t BIG_DIGIT_PAGES = 3;
+const uint8_t BIG_INK_WIDTH = 11;         // The digit itself
+const uint8_t BIG_POINT_WIDTH = 3;
+#elif BIG_DIGITS == 4
+const uint8_t BIG_DIGIT_PAGES = 4;
+const uint8_t BIG_INK_WIDTH = 15;
+const uint8_t BIG_POINT_WIDTH = 4;
+#else
+#error "BIG_DIGITS has to be 3 or 4"
+#endif
+const uint8_t BIG_DIGIT_WIDTH = BIG_INK_WIDTH + BIG_POINT_WIDTH + 2;   // Slot, with a blank column either side of the point
+
+uint8_t bigDigitColumn(uint8_t glyph, uint8_t page, uint8_t col);   // One byte of a glyph, col < BIG_DIGIT_WIDTH
+
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+/*******************************************************************************************************
+What's different about each scale, in one place.
+
+There are three of them, built from the same code:
+
+   JeffScale       The original 20 kg scale.  I2C OLED, stock HX711 (10 SPS), "Property Of" splash.
+   KittyScale      The same parts, with the encoder wired A/B the other way round.
+   FiveKgScale     5 kg load cell, SPI OLED, HX711 with RATE strapped high (80 SPS).
+
+Each is a traits struct of compile-time constants - pins, display transport, conversion rate, range -
+and Board is whichever one is being built.  The platformio.ini environment picks it (-DJEFF_SCALE,
+-DKITTY_SCALE or -DFIVE_KG_SCALE), so `pio run` builds all three and nothing has to be edited to switch.
+Everything reads Board::..., and since they're constants the code for the other boards compiles away:
+there's no run-time test of which board this is anywhere.
+
+The hot pins (the HX711's DOUT and SCK, the SPI panel's CS and D/C) go through FastPin<pin>, which
+works out the port register and bit from the pin number when it's compiled.  Setting or testing a pin
+is then a single sbi/cbi/sbic instruction, instead of digitalWrite()'s table lookups or a pointer and
+mask kept in RAM, and a single instruction can't be cut in half by an ISR.
+
+The preprocessor still picks what changes which code is compiled (BIG_DIGITS, in ScaleConfig.h).
+*******************************************************************************************************/
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <Arduino.h>
+#include "ScaleConfig.h"
+
+struct JeffScale {
+   static constexpr uint8_t ENC_A = 6;             // Rotary encoder
+   static constexpr uint8_t ENC_B = 7;
+   static constexpr uint8_t ENC_SW = 8;
+   static constexpr uint8_t HX711_DOUT = 4;
+   static constexpr uint8_t HX711_SCK = 5;
+   static constexpr uint8_t BAT_PIN = A7;          // Battery, through a 10k/10k divider
+   static constexpr uint16_t HX711_SPS = 10;       // Stock module, RATE tied low
+   static constexpr bool OLED_SPI = false;         // I2C panel
+   static constexpr uint8_t OLED_I2C_ADDRESS = 0x3c;
+   static constexpr uint8_t RANGE_LBS = 44;
+   static constexpr bool SPLASH_OWNER = true;      // "Property Of J. Penney" instead of the range
+};
+
+struct KittyScale : JeffScale {
+   static constexpr uint8_t ENC_A = 7;             // Wired my pins flipped, oops...
+   static constexpr uint8_t ENC_B = 6;
+   static constexpr bool SPLASH_OWNER = false;
+};
+
+struct FiveKgScale : JeffScale {
+   static constexpr uint16_t HX711_SPS = 80;       // RATE strapped high
+   static constexpr bool OLED_SPI = true;
+   static constexpr uint8_t OLED_CS_PIN = 2;
+   static constexpr uint8_t OLED_DC_PIN = 9;
+   static constexpr uint8_t OLED_RST_PIN = 3;
+   static constexpr uint8_t RANGE_LBS = 11;
+   static constexpr bool SPLASH_OWNER = false;
+};
+
+#if defined(FIVE_KG_SCALE)
+typedef FiveKgScale Board;
+#elif defined(KITTY_SCALE)
+typedef KittyScale Board;
+#else
+typedef JeffScale Board;
+#endif
+
+#ifdef ARDUINO
+//************************************************************************************
+// A Nano digital pin (D0-D13, A0-A5) known when compiling.  The register addresses
+// are the ATmega328P's data-space ones: each port's PIN register with its DDR and
+// PORT right after, and PCMSK0-2 for the pin-change groups.
+//************************************************************************************
+template <uint8_t Pin>
+struct FastPin {
+   static_assert(Pin < 20, "FastPin is for D0-D13 and A0-A5");
+   static constexpr uint8_t BIT = Pin < 8 ? Pin : Pin < 14 ? Pin - 8 : Pin - 14;
+   static constexpr uint8_t MASK = 1 << BIT;
+   static constexpr uint8_t PIN_ADDRESS = Pin < 8 ? 0x29 : Pin < 14 ? 0x23 : 0x26;   // PIND, PINB, PINC
+   static constexpr uint8_t PCIE_BIT = Pin < 8 ? PCIE2 : Pin < 14 ? PCIE0 : PCIE1;   // Its bit in PCICR and PCIFR
+   static constexpr uint8_t PCMSK_ADDRESS = 0x6B + PCIE_BIT;                         // PCMSK0-2, its bit is BIT
+
+   static volatile uint8_t &in() { return *(volatile uint8_t *)PIN_ADDRESS; }
+   static volatile uint8_t &ddr() { return *(volatile uint8_t *)(PIN_ADDRESS + 1); }
+   static volatile uint8_t &port() { return *(volatile uint8_t *)(PIN_ADDRESS + 2); }
+   static volatile uint8_t &pcmsk() { return *(volatile uint8_t *)PCMSK_ADDRESS; }
+
+   static bool read() { return in() & MASK; }
+   static void high() { port() |= MASK; }
+   static void low() { port() &= (uint8_t)~MASK; }
+   static void output() { ddr() |= MASK; }
+   static void input() { ddr() &= (uint8_t)~MASK; low(); }   // No pull-up
+};
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+/*******************************************************************************************************
+A piece of text on the display that only rewrites the characters that changed.
+
+The weight screen used to clear the whole panel and reprint everything whenever a digit changed -
+over a thousand bytes down the bus each time, and the flashing we kept trying to hide.  A
+DisplayField remembers what it last put on the panel.  Print the new text into it (it's a Print,
+so printDecimal() etc. work) and show() sends just the characters that differ, with one setCursor()
+per run of changed characters:
+
+   poundsField.start();
+   printDecimal(poundsField, val);
+   poundsField.show(oled);
+
+Text shorter than the field is padded with blanks, longer is cut off.  After anything else has drawn
+over the field (a clear(), a menu) call forget() so the next show() knows the panel is blank there.
+Only the characters that got into the display queue count as shown.  If it was full, show() returns
+false, and the next show() sends the rest.
+
+A field of big digits (BigDigits.h) is a number.  It's right-aligned, a '.' goes in with the digit
+before it, and a changed digit only sends the columns that differ.
+*******************************************************************************************************/
+#ifndef DISPLAY_FIELD_H
+#define DISPLAY_FIELD_H
+
+#include <Arduino.h>
+#include "ShadowDisplay.h"
+
+const uint8_t DISPLAY_FIELD_MAX = 8;   // Characters.  Our fields are 6 wide.
+
+class DisplayField : public Print {
+public:
+   void begin(uint8_t col, uint8_t row, uint8_t width, uint8_t size);   // col in pixels, row in pages, size 1, 2 or BIG_DIGITS
+   void start();                   // Begin printing new text into the field
+   bool show(ShadowDisplay &oled);  // Put it on the panel, changed characters only.  False if some have to wait.
+   void forget();                  // Panel was cleared under us, it's all blanks now
+   size_t write(uint8_t c);
+   using Print::write;
+
+private:
+   #ifdef BIG_DIGITS
+   bool showBig(ShadowDisplay &oled);
+   #endif
+
+   char shown[DISPLAY_FIELD_MAX];  // What's on the panel
+   char text[DISPLAY_FIELD_MAX];   // What start()/print() built
+   uint8_t length;                 // Characters printed into text so far
+   uint8_t col;
+   uint8_t row;
+   uint8_t width;                  // Characters, or big digit slots
+   uint8_t size;
+};
+
+#endif
@@ -0,0 +1,99 @@
+/*******************************************************************************************************
+Display command queue, so drawing never holds up sampling for long.
+
+Every SSD1306Ascii call runs to the end of its bus transfer before it returns.  A character in 2X is
+30 bytes, which is most of a millisecond on 400 kHz I2C, and a screen's worth of them is tens of ms
+in which loop() isn't draining the load cell or reading the knob.
+
+ShadowDisplay sends its panel calls here instead.  They're packed into a small byte queue (a char is
+one byte, a cursor move three) and the display task sends them in slices: service() keeps going
+until the queue is empty or the next command might not fit in what's left of DISPLAY_SLICE_US
+(ScaleConfig.h), going by the slowest one it's sent so far.  A slice always sends at least one
+command, so the longest slice is the budget or the slowest single command, whichever is more.
+Clearing a field is split into one-character pieces, and a big digit (BigDigits.h) into pages, so
+neither is ever the slowest.  Anything that waits in a loop of its own (acquisitionDelay(), the
+value editors) calls service() too.
+
+Nothing is ever sent from the calls that queue a command, so drawing never waits on the bus.  If the
+queue hasn't room for a command it's turned away (an overflow): the call returns false (write()
+returns 0) and the drawing code has to try it again on a later pass - ShadowDisplay and the screens
+built on it pick up where they stopped (see ShadowDisplay.h).  Once one command has been turned away
+everything after it is too, until the next slice, so nothing ever gets onto the panel ahead of
+something that should have gone before it.  The contrast isn't a command at all, just the latest
+value, sent at the start of the next slice.
+
+report() prints the longest slice, the most the queue ever held and the overflows.  room() is how many
+bytes will still go in, for ShadowDisplay to fill the queue from its grid without being turned away.
+
+Commands keep their order, so the panel always ends up exactly as if they'd been sent directly.
+*******************************************************************************************************/
+#ifndef DISPLAY_QUEUE_H
+#define DISPLAY_QUEUE_H
+
+#include <Arduino.h>
+#include "ScaleConfig.h"
+#include "Hal.h"
+#include "SampleRing.h"
+#include "BigDigits.h"
+
+#ifndef DISPLAY_QUEUE_SIZE
+#define DISPLAY_QUEUE_SIZE 64      // Bytes, a power of two
+#endif
+// Text that isn't on the 2X grid (1X, big digits) goes in as it's drawn, so one menu row
+// of it, with the blanking under it, has to fit in an empty queue or it never goes.
+static_assert(DISPLAY_QUEUE_SIZE >= 64, "The display queue must hold a whole menu row");
+
+class DisplayQueue {
+public:
+   DisplayQueue(ScaleDisplay &panel);
+   void begin();                   // Sets up the panel straight away
+   // These queue a command.  False (write() 0) if it was turned away, see above.
+   bool set1X();
+   bool set2X();
+   bool setCursor(uint8_t col, uint8_t row);
+   bool clearField(uint8_t col, uint8_t row, uint8_t n);
+   bool clearToEOL();
+   size_t write(uint8_t c);
+   #ifdef BIG_DIGITS
+   bool writeBig(uint8_t col, uint8_t row, uint8_t glyph, uint8_t oldGlyph);   // Over oldGlyph, only what differs
+   #endif
+   void setContrast(uint8_t value);   // Goes at the start of the next slice
+   uint8_t room();                    // Bytes that will still go in, 0 once something's been turned away
+
+   bool service(uint16_t budgetUs);   // Send for up to budgetUs.  True while there's more waiting.
+   void drain();                      // Send everything now
+   uint16_t worstSliceUs() { return worstSlice; }
+   void report(Print &out);           // Longest slice, most queued, overflows
+
+private:
+   bool push(uint8_t command, uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0);
+   void sendNext();
+   #ifdef BIG_DIGITS
+   void sendBigPage();
+   bool pending() { return clearLeft || bigPagesLeft || !queue.isEmpty(); }
+   #else
+   bool pending() { return clearLeft || !queue.isEmpty(); }
+   #endif
+
+   ScaleDisplay &panel;
+   SampleRing<uint8_t, DISPLAY_QUEUE_SIZE> queue;
+   uint8_t sentMagnify;            // Size the panel is at, as far as we've sent
+   uint8_t clearCol;               // The field clear in progress
+   uint8_t clearRow;
+   uint8_t clearLeft;              // Characters still to clear
+   #ifdef BIG_DIGITS
+   uint8_t bigCol;                 // The big digit in progress, sent a page at a time
+   uint8_t bigRow;
+   uint8_t bigGlyph;
+   uint8_t bigOld;
+   uint8_t bigPagesLeft;
+   #endif
+   int16_t contrast;               // To send, -1 for none
+   bool closed;                    // Something's been turned away since the last slice
+   uint16_t worstSlice;            // us
+   uint16_t slowestSend;           // us, the longest one command has taken
+   uint8_t mostQueued;
+   uint16_t overflows;
+};
+
+#endif
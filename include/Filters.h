@@ -0,0 +1,96 @@
+/*******************************************************************************************************
+Filter chain between the raw HX711 counts and the weight.
+
+Each raw sample goes through three stages, any of which can be turned off in ScaleConfig.h:
+
+   MedianFilter   Median of the last N samples.  Throws away single-sample spikes (a bump on the
+                  bench, a bad conversion) before they can drag the average around.
+   StepAverage    Moving average whose window restarts whenever the input jumps by more than the
+                  step threshold, then grows back one sample at a time up to the full size.  A new
+                  load shows up right away instead of crawling in over a full window, and a still
+                  load still gets the full window of averaging.
+   IirFilter      First-order low-pass, y += (x - y) / 2^shift.  Takes the last-digit jitter off
+                  while the average window is still short.  Restarted along with the average.
+
+Everything works on int32 counts so the fixed-point build stays float free.
+*******************************************************************************************************/
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdint.h>
+#include "ScaleConfig.h"
+
+#ifndef FILTER_MEDIAN_SIZE
+#define FILTER_MEDIAN_SIZE 3
+#endif
+#ifndef FILTER_AVERAGE_SIZE
+#define FILTER_AVERAGE_SIZE 16
+#endif
+#ifndef FILTER_IIR_SHIFT
+#define FILTER_IIR_SHIFT 1
+#endif
+
+static_assert(FILTER_MEDIAN_SIZE >= 1 && FILTER_MEDIAN_SIZE <= 7 && (FILTER_MEDIAN_SIZE & 1),
+              "FILTER_MEDIAN_SIZE must be odd, 1 (off) to 7");
+static_assert(FILTER_AVERAGE_SIZE >= 1 && FILTER_AVERAGE_SIZE <= 64, "FILTER_AVERAGE_SIZE must be 1 to 64");
+static_assert(FILTER_IIR_SHIFT <= 6, "FILTER_IIR_SHIFT must be 0 (off) to 6");
+
+class MedianFilter {
+public:
+   MedianFilter();
+   int32_t process(int32_t x);
+   void reset();
+private:
+   int32_t history[FILTER_MEDIAN_SIZE];
+   uint8_t index;
+   uint8_t count;
+};
+
+class StepAverage {
+public:
+   StepAverage();
+   int32_t process(int32_t x);          // Returns the average of the current window
+   void reset();
+   void setStepThreshold(int32_t counts);   // 0 never restarts the window
+   bool isFull() const { return count == FILTER_AVERAGE_SIZE; }
+   bool stepped() const { return stepFlag; }   // True if the last sample restarted the window
+   uint8_t windowSize() const { return count; }
+   int32_t value() const;
+private:
+   int32_t dataSet[FILTER_AVERAGE_SIZE];
+   int32_t sum;
+   int32_t stepThreshold;
+   uint8_t index;
+   uint8_t count;
+   bool stepFlag;
+};
+
+class IirFilter {
+public:
+   IirFilter();
+   int32_t process(int32_t x);
+   void reset(int32_t x);
+   int32_t value() const;
+private:
+   int32_t state;     // Output with 4 extra fraction bits so small steps aren't lost to truncation
+   bool primed;
+};
+
+class FilterChain {
+public:
+   FilterChain() : output(0) {}
+   int32_t process(int32_t raw);        // Run one raw sample through and return the filtered value
+   void reset();
+   void setStepThreshold(int32_t counts) { average.setStepThreshold(counts); }
+   bool isSettled() const { return average.isFull(); }   // Full average window since the last restart
+   bool stepped() const { return average.stepped(); }
+   uint8_t windowSize() const { return average.windowSize(); }
+   int32_t value() const { return output; }
+private:
+   MedianFilter median;
+   StepAverage average;
+   IirFilter iir;
+   int32_t output;
+};
+
+#endif
@@ -0,0 +1,86 @@
+/*******************************************************************************************************
+Hardware abstraction for the scale.
+
+main.cpp only talks to the hardware through these thin classes, plus the HX711 sample source in
+Hx711Isr.h for the load cell.  Each one is implemented twice:
+
+   src/Hal.cpp, src/Hx711Isr.cpp      The Nano.  Forwards to SSD1306Ascii, ClickEncoder, TimerOne, EEPROM
+                                      and the pin-change HX711 driver.
+   lib/NativeSim                      The [env:native] host build.  Simulated devices, a scripted load and
+                                      knob, and a main() that runs setup()/loop() on a simulated clock.
+
+Which implementation gets linked is decided by the build environment, so there are no virtual
+functions here (their vtables would cost SRAM on the Nano) - only ScaleDisplay is virtual, through
+Print, the same as the display library it wraps.
+*******************************************************************************************************/
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+
+//************************************************************************************
+// Text display.  Same calls and units as SSD1306Ascii:  col is in pixels, row is in
+// 8-pixel pages, and 2X characters are twice as wide and two rows tall.
+//************************************************************************************
+class ScaleDisplay : public Print {
+public:
+   void begin();                   // Set up the variant's OLED with the 5x7 font
+   void clear();
+   void set1X();
+   void set2X();
+   void setCursor(uint8_t col, uint8_t row);
+   void clearField(uint8_t col, uint8_t row, uint8_t n);   // Blank n characters and leave the cursor there
+   void clearToEOL();
+   uint8_t fontRows();             // Rows per character at the current size
+   uint8_t fieldWidth(uint8_t n);  // Pixels across n characters at the current size
+   size_t write(uint8_t c);
+   using Print::write;
+   void setContrast(uint8_t value);   // Panel brightness, 0-255
+   void writeBig(uint8_t glyph, uint8_t page, uint8_t first, uint8_t n);   // n columns of one page of a big digit (BigDigits.h), from column first, at the cursor
+
+   // Other ways of driving the panel, for the display benchmark (DISPLAY_BENCHMARK, see
+   // OledBus.h).  useBusSetting() restarts the panel on one, blank; begin() goes back.
+   uint8_t busSettings();
+   const __FlashStringHelper *useBusSetting(uint8_t n);   // Returns its name
+};
+
+//************************************************************************************
+// Rotary encoder with push switch.  The button states match ClickEncoder's.
+//************************************************************************************
+enum KnobButton {
+   KNOB_OPEN = 0,
+   KNOB_CLOSED,
+   KNOB_PRESSED,
+   KNOB_HELD,
+   KNOB_RELEASED,
+   KNOB_CLICKED,
+   KNOB_DOUBLE_CLICKED
+};
+
+class ScaleKnob {
+public:
+   void begin(uint8_t pinA, uint8_t pinB, uint8_t pinSw, uint8_t stepsPerNotch);
+   void service();                 // From the 1 ms timer tick
+   int16_t getValue();             // Notches turned since the last call
+   KnobButton getButton();
+};
+
+//************************************************************************************
+// Periodic timer interrupt (drives the knob debouncing)
+//************************************************************************************
+class ScaleTimer {
+public:
+   static void begin(unsigned long periodUs, void (*isr)());
+};
+
+//************************************************************************************
+// Non-volatile storage (the EEPROM on the Nano).  Writes skip bytes that already
+// hold the value so they don't use up EEPROM life.
+//************************************************************************************
+class ScaleStorage {
+public:
+   static void read(int address, void *data, uint8_t len);
+   static void write(int address, const void *data, uint8_t len);
+};
+
+#endif
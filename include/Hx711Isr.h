@@ -0,0 +1,50 @@
+/*******************************************************************************************************
+Interrupt-driven HX711 acquisition.
+
+The HX711 pulls DOUT low when a new conversion is ready and holds it low until the 24-bit word is
+clocked out.  We put a pin-change interrupt on DOUT so the falling edge runs an ISR that clocks the
+word out right away and pushes it, with a millis() timestamp, into a ring buffer.  The main loop
+drains the ring whenever it gets around to it.  That way a conversion is never lost just because the
+UI was sitting in a delay() or waiting for a click.
+
+If the main loop falls so far behind that the ring is full, the ISR still reads the conversion (it has
+to, to re-arm the HX711) but drops it and bumps the overrun counter.  So every conversion is accounted
+for:  captured = consumed + overruns + still waiting in the ring.
+
+There is only one HX711 on the board so the driver is all static, and its pins are the board's
+(Board::HX711_DOUT and HX711_SCK), fixed when it's compiled.
+*******************************************************************************************************/
+#ifndef HX711_ISR_H
+#define HX711_ISR_H
+
+#include <stdint.h>
+#include "SampleRing.h"
+
+#ifndef HX711_RING_SIZE
+#define HX711_RING_SIZE 16   // Must be a power of two.  16 samples is 1.6 s at 10 SPS.
+#endif
+
+// One HX711 conversion as captured by the ISR
+struct Hx711Sample {
+   int32_t raw;      // Sign-extended 24-bit conversion result
+   uint32_t time;    // millis() when the conversion was read out
+};
+
+class Hx711Isr {
+public:
+   static void begin();
+   static bool read(Hx711Sample &sample);   // Pop the oldest waiting sample.  Main loop only.
+   static uint8_t waiting();                // Number of samples sitting in the ring
+
+   static uint32_t captured();              // Conversions read out by the ISR since begin()
+   static uint16_t overruns();              // Conversions dropped because the ring was full
+
+   static void handleInterrupt();           // Called from the pin-change vector only
+
+private:
+   static SampleRing<Hx711Sample, HX711_RING_SIZE> ring;
+   static volatile uint32_t capturedCount;
+   static volatile uint16_t overrunCount;
+};
+
+#endif
@@ -0,0 +1,71 @@
+/*******************************************************************************************************
+Load cell front end for the interrupt-driven HX711 acquisition (Hx711Isr).
+
+Drains the ISR's sample ring through the filter chain (Filters.h) and keeps the tare offset and
+calibration factor that the HX711_ADC library does, using the same method names.  That lets loop() and the menu
+callbacks use either one without caring which acquisition mode was built.
+
+Only the parts of the HX711_ADC interface that the scale actually uses are here.  Unlike the library,
+the weight comes back as weight_t and the cal factor is a decimal_t (see WeightMath.h), so the
+fixed-point build never touches a float.
+*******************************************************************************************************/
+#ifndef ISR_LOAD_CELL_H
+#define ISR_LOAD_CELL_H
+
+#include <stdint.h>
+#include "Hx711Isr.h"
+#include "WeightMath.h"
+#include "Filters.h"
+
+// Called with every conversion as it comes out of the filter chain
+typedef void (*SampleHandler)(weight_t weight, uint32_t time);
+// Called with every raw conversion before it goes into the filter chain
+typedef void (*RawHandler)(int32_t raw, uint32_t time);
+
+class IsrLoadCell {
+public:
+   IsrLoadCell();
+
+   void begin();
+   void start(unsigned long stabilizingTime, bool doTare);
+   uint8_t update();                          // Drain the sample ring.  Returns 1 if new data came in.
+   void setSampleHandler(SampleHandler handler);   // Get every conversion during update().  0 for none.
+   void setRawHandler(RawHandler handler);         // Same, raw counts
+   weight_t getData();                        // Averaged, tared and calibrated reading
+   void setCalFactor(decimal_t cal);          // HX711 counts per pound
+   decimal_t getCalFactor();
+   void tareNoDelay();                        // Re-zero once the filter has settled again
+   bool getTareStatus();                      // True once (and only once) after a tareNoDelay() completes
+   void cancelTare();                         // Drop a pending tareNoDelay(), keeping the old zero
+   int32_t getTareOffset();
+   void setTareOffset(int32_t offset);
+   void refreshDataSet();                     // Restart the filter and wait for it to settle on fresh samples (blocks)
+   void restartDataSet();                     // Same, without waiting.  Poll getDataSetStatus().
+   bool getDataSetStatus();                   // True once the filter has a full window since the last restart
+   uint8_t getDataSetCount();                 // Samples in the window so far
+   uint8_t getSamplesInUse();                 // Samples in a full window
+   decimal_t getNewCalibration(decimal_t knownMass);  // Compute and apply a cal factor from a known weight
+
+   uint32_t getSamplesConsumed();
+   uint32_t getSamplesCaptured();
+   uint16_t getOverruns();
+   uint16_t getSteps();                       // Times the filter restarted on a load change
+
+private:
+   int32_t smoothedData();
+
+   FilterChain filter;
+   int32_t tareOffset;
+   decimal_t calFactor;
+   #ifndef FLOAT_WEIGHT_MATH
+   WeightScale weightScale;                   // Reciprocal of calFactor
+   #endif
+   bool tarePending;
+   bool tareDone;
+   uint32_t consumedCount;
+   uint16_t stepCount;
+   SampleHandler sampleHandler;
+   RawHandler rawHandler;
+};
+
+#endif
@@ -0,0 +1,50 @@
+/*******************************************************************************************************
+Where the Nano's 2K of RAM goes, while it's running.
+
+Three things share it:
+
+   static    .data and .bss, fixed when it's linked: our globals, the libraries' (SSD1306Ascii, HX711_ADC's
+             data set, the Serial buffers), and whatever the menu tables etc. still keep in RAM
+   heap      Grows up from the end of static.  Only the ClickEncoder (new'd in Hal.cpp) lives there.
+   stack     Grows down from the top of RAM, as deep as the deepest call chain and the ISRs on top of it
+
+and what's between the top of the heap and the bottom of the stack is free.  The stack's low point is
+what matters, and it doesn't show from the stack pointer once the deep call has returned, so the free
+space is painted with STACK_PAINT before anything runs (in .init3, ahead of the C runtime setup).
+Whatever the stack has reached since isn't STACK_PAINT any more, so counting the bytes that still are,
+from the top of the heap up, gives the least free RAM since power on.  (A local array that's never
+written doesn't show, so it reads a few bytes short on those.)
+
+readMemoryStats() takes a snapshot.  'm' on the serial port prints one (reportMemory()), and "RAM" in
+the first menu shows it on the panel (displayMemoryStats() in main.cpp).  The scan is a byte compare
+per free byte, about 100 us on the Nano, so it's only done when asked.
+
+tools/ram_report.py breaks the static RAM down by module when the firmware is linked, for each build
+environment.
+
+Nano build only.  The native build has no AVR RAM to measure, readMemoryStats() returns false there.
+*******************************************************************************************************/
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <Arduino.h>
+#include "ScaleConfig.h"
+
+#ifdef MEMORY_STATS
+
+struct MemoryStats {
+   uint16_t total;           // All of RAM, bytes
+   uint16_t staticRam;       // .data and .bss
+   uint16_t heap;            // Top of the heap above the end of static
+   uint16_t stack;           // Stack in use now
+   uint16_t free;            // Between the heap and the stack now
+   uint16_t stackPeak;       // Deepest the stack has been since power on
+   uint16_t leastFree;       // Least free RAM there's been since power on
+};
+
+bool readMemoryStats(MemoryStats &stats);
+void reportMemory(Print &out);     // One line, for the serial port
+
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/*******************************************************************************************************
+Menu tables, kept in flash.
+
+A menu is a menu structure (its items, how many there are and how deep it sits) and an array of
+menuItems (title, click/held callbacks, child menu and renderer).  All of it, titles included, is
+PROGMEM, so none of it is copied into RAM at startup.  The navigation and drawing code reads it through
+menuCount(), menuLevel() and menuItemAt(), never directly.
+
+A menu is described by what its items do, and the tables are built from that when they're compiled:
+
+   constexpr menuItem L1_items[] PROGMEM = {
+      subMenu(memoryTitle, L2_mem_menu),          // Click (or hold) to go into L2_mem_menu
+      action(clearMemTitle, clearAllMem),         // Click to run clearAllMem()
+      action(batteryTitle, checkBattery, drawBattery),   // With its own renderer
+   };
+   constexpr menu L1_menu PROGMEM = makeMenu(L1_items, L0_menu);   // L0_menu's level + 1
+
+Nothing in a menu is counted by hand.  makeMenu() takes the count from the size of the item array and
+the level from the parent menu.  The exception is a menu of items that only differ by their number
+(the memory slots).  That's one numberedItem() with no title, and makeNumberedMenu() says how many it
+stands for.
+
+Only a subMenu() is pushed on the menu stack.  An action runs and the menu it was picked from stays
+up, so the actions never touch the stack themselves.  That makes the stack exactly as deep as the
+menu tree, which menuDepth() works out from the tables, so the stack is sized to fit and nothing can
+push past the end of it.  (A menu that's its own ancestor would be bottomless, and won't compile.)
+
+What it saved, on the Nano (2-byte pointers and ints), in the tables as they were before.  These are
+estimates, worked out by hand from the sizes of the structs and strings, not read from a build: check
+them against tools/ram_report.py or the map file before quoting them.
+
+                     RAM before     RAM after      flash after
+   menu items        192 bytes      0              11 x 10 = 110 bytes
+   menus             -              0              4 x 4 = 16 bytes
+   titles            152 bytes      0              80 bytes (the menu names are gone, nothing showed them)
+   total             344 bytes      0              206 bytes
+
+plus 26 more RAM bytes before with DISPLAY_BENCHMARK's item.  The .data image in flash that used to
+be copied into RAM goes away too, so flash doesn't grow from the move (what it gets is the few reads
+below).
+*******************************************************************************************************/
+#ifndef MENU_H
+#define MENU_H
+
+#include <Arduino.h>
+
+struct menu;
+
+struct menuItem {
+   const char *menuItem;         // Item title (PROGMEM), 0 for one item standing for a numbered menu
+   void (*clickFuncPtr)();       // Pointer to rotary-switch "click" callback function
+   void (*heldFuncPtr)();        // Pointer to rotary-switch "held" callback function
+   const struct menu *childMenu; // The menu to push when it's clicked or held, 0 for an action
+   void (*drawFuncPtr)(const struct menuItem &item, int index, uint8_t row);   // Draws the item after the cursor marker (drawTitle() for just the title)
+};
+
+struct menu {
+   const struct menuItem *items;
+   uint8_t numMenuItems;         // Total number of menu items for this level
+   uint8_t menuLevel;            // L0 is the top, each sub-menu one more (L1, L2, etc.)
+};
+
+void doNothing();
+void drawTitle(const struct menuItem &item, int index, uint8_t row);   // Just the title
+
+// The items.  A sub-menu is gone into by a click or a hold.  An action runs click
+// (or held) and leaves its menu up.
+constexpr menuItem subMenu(const char *title, const menu &child) {
+   return menuItem{title, doNothing, doNothing, &child, drawTitle};
+}
+
+constexpr menuItem action(const char *title, void (*click)(),
+                          void (*draw)(const menuItem &, int, uint8_t) = drawTitle) {
+   return menuItem{title, click, doNothing, 0, draw};
+}
+
+// Stands for every item of a numbered menu, which draw tells apart by their index
+constexpr menuItem numberedItem(void (*click)(), void (*held)(), void (*draw)(const menuItem &, int, uint8_t)) {
+   return menuItem{0, click, held, 0, draw};
+}
+
+// A menu of the items in an array, one level below its parent.  The top menu has no parent.
+template <size_t N>
+constexpr menu makeMenu(const menuItem (&items)[N], const menu &parent) {
+   static_assert(N < 256, "Too many items for one menu");
+   return menu{items, (uint8_t)N, (uint8_t)(parent.menuLevel + 1)};
+}
+
+template <size_t N>
+constexpr menu makeMenu(const menuItem (&items)[N]) {
+   static_assert(N < 256, "Too many items for one menu");
+   return menu{items, (uint8_t)N, 0};
+}
+
+// count items made from the one untitled item, see menuItemAt()
+constexpr menu makeNumberedMenu(const menuItem (&item)[1], uint8_t count, const menu &parent) {
+   return menu{item, count, (uint8_t)(parent.menuLevel + 1)};
+}
+
+// How many menus deep the tree under m goes, counting m.  Only a numbered menu's first
+// item is real, the rest are made from it.
+constexpr uint8_t menuDepth(const menu &m);
+
+constexpr uint8_t deeperOf(uint8_t a, uint8_t b) {
+   return a > b ? a : b;
+}
+
+constexpr uint8_t itemsDepth(const menuItem *items, uint8_t n) {
+   return n == 0 ? 0 : deeperOf(items->childMenu ? menuDepth(*items->childMenu) : 0, itemsDepth(items + 1, n - 1));
+}
+
+constexpr uint8_t menuDepth(const menu &m) {
+   return 1 + itemsDepth(m.items, m.items[0].menuItem ? m.numMenuItems : 1);
+}
+
+inline uint8_t menuCount(const menu *m) {
+   return pgm_read_byte(&m->numMenuItems);
+}
+
+inline uint8_t menuLevel(const menu *m) {
+   return pgm_read_byte(&m->menuLevel);
+}
+
+// Item i of a menu, copied out of flash.  A menu whose first item has no title is one
+// item standing for all numMenuItems of them, told apart by their index.
+inline menuItem menuItemAt(const menu *m, int i) {
+   const menuItem *items = (const menuItem *)pgm_read_ptr(&m->items);
+   if(!pgm_read_ptr(&items[0].menuItem)) {
+      i = 0;
+   }
+   menuItem item;
+   memcpy_P(&item, &items[i], sizeof(item));
+   return item;
+}
+
+inline const __FlashStringHelper *menuTitle(const menuItem &item) {
+   return (const __FlashStringHelper *)item.menuItem;
+}
+
+#endif
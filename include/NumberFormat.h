@@ -0,0 +1,33 @@
+/*******************************************************************************************************
+Number formatting for the display and the serial port, without floats or printf.
+
+Print's float path does a float multiply and subtract for every digit, its integer path a 32-bit divide
+for every digit (the AVR does those in software, several hundred cycles each), and the low battery line
+used sprintf(), which brings all of vfprintf into flash.  Everything the scale shows is really a whole
+number of hundredths or millivolts, so these take an integer and where the decimal point goes:
+
+   formatFixed(buf, -105, 2)        "-1.05"
+   formatFixed(buf, 105, 2, 6)      "  1.05"   Right-justified in 6, the sign just ahead of the digits
+   formatFixed(buf, 7, 2)           "0.07"
+   formatFixed(buf, 95, 1)          "9.5"
+
+The digits come from subtracting powers of ten (a table in flash), so formatting has no divide in it
+at all.  That's only formatFixed() and printFixed() themselves: a caller that has to scale its value
+first still pays for that (the battery's millivolts cut to hundredths or tenths, and the benchmark's
+us to ms, each take one divide before they get here).  The caller owns the buffer, which has to be
+NUMBER_BUFFER_SIZE bytes - enough for any int32_t with any decimals and the terminator.  printFixed()
+formats on the stack and hands the whole thing to a Print in one write().  benchmarkNumberFormat() (Benchmarks.h) times them against Print's own, and
+tools/flash_report.py prints the flash each takes after every Nano build.
+*******************************************************************************************************/
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <Arduino.h>
+
+const uint8_t NUMBER_BUFFER_SIZE = 13;     // "-21474836.48" and the terminator (width is cut to fit too)
+const uint8_t NUMBER_MAX_DECIMALS = 9;
+
+uint8_t formatFixed(char *buf, int32_t value, uint8_t decimals, uint8_t width = 0);   // value / 10^decimals, returns the length
+size_t printFixed(Print &out, int32_t value, uint8_t decimals, uint8_t width = 0);
+
+#endif
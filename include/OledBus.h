@@ -0,0 +1,110 @@
+/*******************************************************************************************************
+Faster bus code for the OLED, underneath SSD1306Ascii.
+
+SSD1306Ascii does all the font work and hands each byte to its transport's writeDisplay().  The
+transports that come with it are written to work on any board, and it shows:
+
+   SSD1306AsciiSpi      Every byte is a SPI transaction of its own, with digitalWrite()s for D/C and
+                        chip select around it.  The four or so us of digitalWrite() per pin dwarfs the
+                        2 us the byte takes on the wire at 4 MHz.
+   SSD1306AsciiAvrI2c   Every command byte is an I2C transfer of its own (start, address, control
+                        byte, the command, stop), and so is every character's worth of data.
+
+These two talk to the AVR's SPI and TWI registers directly:
+
+   SpiOled      D/C and chip select are FastPins (Board.h), one instruction each, and the byte goes
+                straight into SPDR at OLED_SPI_HZ (ScaleConfig.h).  Chip select stays down across a
+                character.  The pins are template parameters, from the board's traits.
+   I2cOled      Keeps the transfer open as long as the bytes are the same kind, so a cursor move is
+                one transfer and a run of characters along a page is another, at OLED_I2C_HZ.  The
+                panel is the only thing on the bus, so nothing else is waiting for it.
+
+ScaleDisplay (Hal.cpp) picks one of these or the library's own, and the display benchmark in
+main.cpp times them all.  Nano build only.
+*******************************************************************************************************/
+#ifndef OLED_BUS_H
+#define OLED_BUS_H
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "SSD1306Ascii.h"
+#include "Board.h"
+
+template <uint8_t CsPin, uint8_t DcPin, uint8_t RstPin>
+class SpiOled : public SSD1306Ascii {
+public:
+   void begin(const DevType *dev, uint32_t hz);
+
+protected:
+   void writeDisplay(uint8_t b, uint8_t mode);
+
+private:
+   typedef FastPin<CsPin> Cs;
+   typedef FastPin<DcPin> Dc;
+};
+
+class I2cOled : public SSD1306Ascii {
+public:
+   void begin(const DevType *dev, uint8_t address, uint32_t hz);
+   void endTransfer();       // Let go of the bus (before something else drives the TWI)
+
+protected:
+   void writeDisplay(uint8_t b, uint8_t mode);
+
+private:
+   void start(uint8_t control);
+   void send(uint8_t b);
+   void stop();
+
+   uint8_t address;
+   uint8_t openControl;      // Control byte of the transfer in progress, NOT_OPEN between transfers
+};
+
+//************************************************************************************
+// SPI.  Reset the panel, set up the pins and the SPI clock, then let the library
+// send the init commands through us.
+//************************************************************************************
+template <uint8_t CsPin, uint8_t DcPin, uint8_t RstPin>
+void SpiOled<CsPin, DcPin, RstPin>::begin(const DevType *dev, uint32_t hz) {
+   pinMode(RstPin, OUTPUT);
+   digitalWrite(RstPin, LOW);
+   delay(10);
+   digitalWrite(RstPin, HIGH);
+   delay(10);
+
+   Cs::high();
+   Cs::output();
+   Dc::output();
+
+   // The SPI library works out the clock divider and mode bits.  They stay in SPCR/SPSR
+   // after the transaction ends, and we're the only thing on the bus.
+   SPI.begin();
+   SPI.beginTransaction(SPISettings(hz, MSBFIRST, SPI_MODE0));
+   SPI.endTransaction();
+
+   init(dev);
+}
+
+// The timer and HX711 ISRs write port pins too, but each of these is a single sbi or
+// cbi, so there's nothing for them to interrupt.
+template <uint8_t CsPin, uint8_t DcPin, uint8_t RstPin>
+void SpiOled<CsPin, DcPin, RstPin>::writeDisplay(uint8_t b, uint8_t mode) {
+   if(mode == SSD1306_MODE_CMD) {
+      Dc::low();
+   } else {
+      Dc::high();
+   }
+   Cs::low();
+   SPDR = b;
+   while(!(SPSR & _BV(SPIF))) {
+   }
+   if(mode != SSD1306_MODE_RAM_BUF) {   // The library marks the last byte of a character
+      Cs::high();
+   }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+/*******************************************************************************************************
+Hot-path profiling counters.
+
+The scheduler's report says which task is busy.  These go a level down, to the pieces of code inside
+the tasks (the load cell update, weight and menu rendering, the battery read, the knob handling and
+the encoder's timer ISR).  Wrap a section in PROFILE_BEGIN/PROFILE_END and each pass through it adds
+to that section's call count, total, min and max time:
+
+   PROFILE_BEGIN(PROFILE_WEIGHTS);
+   displayWeights();
+   PROFILE_END(PROFILE_WEIGHTS);
+
+report() prints count/min/avg/max for every section and starts a new interval ('p' on the serial
+port does this, see main.cpp).
+
+With PROFILING undefined (ScaleConfig.h) the macros are empty, so there's no code and no RAM.
+Defined, each section costs two micros() reads and a few adds - a handful of us per pass - and 12
+bytes of RAM, which is why it can stay on in the field.  Times are 16-bit, so one pass through a
+section longer than 65 ms reads short (nothing in loop() comes close).  Resolution is micros()'s, 4 us
+on a 16 MHz Nano.
+*******************************************************************************************************/
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "ScaleConfig.h"
+
+enum ProfileSection {
+   PROFILE_LOOP,           // One whole pass through loop()
+   PROFILE_LOAD_CELL,      // loadCell.update()
+   PROFILE_WEIGHTS,        // displayWeights()
+   PROFILE_MENU,           // displayMenu()
+   PROFILE_BATTERY,        // analogRead(BAT_PIN)
+   PROFILE_ENCODER,        // Knob turn and button handling
+   PROFILE_TIMER_ISR,      // timerIsr()
+   PROFILE_DISPLAY,        // One slice of sending queued display commands
+   PROFILE_SECTIONS
+};
+
+#ifdef PROFILING
+
+struct ProfileStats {
+   uint32_t count;           // Passes since the last report
+   uint16_t min;             // us
+   uint16_t max;
+   uint32_t total;
+};
+
+class Profiler {
+public:
+   static void record(uint8_t section, uint16_t elapsed) {
+      ProfileStats &s = stats[section];
+      if(s.total < 0xFFFF0000UL) {   // Stop counting rather than wrap (an hour and more without a report)
+         if(s.count == 0 || elapsed < s.min) {
+            s.min = elapsed;
+         }
+         s.count++;
+         s.total += elapsed;
+         if(elapsed > s.max) {
+            s.max = elapsed;
+         }
+      }
+   }
+   static void report(Print &out);    // All the sections, then start a new interval
+   static void reset();
+
+private:
+   static ProfileStats stats[PROFILE_SECTIONS];
+};
+
+#define PROFILE_BEGIN(section) uint16_t profileStart_##section = (uint16_t)micros()
+#define PROFILE_END(section) Profiler::record(section, (uint16_t)micros() - profileStart_##section)
+
+#else
+
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+
+#endif
+
+#endif
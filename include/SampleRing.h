@@ -0,0 +1,72 @@
+/*******************************************************************************************************
+Single-producer/single-consumer ring buffer.
+
+Used to hand HX711 conversions from the pin-change interrupt (the producer) to the main loop (the
+consumer) without ever having to turn interrupts off.  The head index is only written by the producer
+and the tail index is only written by the consumer.  Both are single bytes so reads and writes of them
+are atomic on the AVR.
+
+The indexes are free-running 8-bit counters, so the buffer size has to be a power of two no larger
+than 128.  (head - tail) is then always the number of entries waiting, even after the counters wrap.
+*******************************************************************************************************/
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+
+template <typename T, uint8_t SIZE>
+class SampleRing {
+   static_assert(SIZE != 0 && (SIZE & (SIZE - 1)) == 0, "SampleRing size must be a power of two");
+   static_assert(SIZE <= 128, "SampleRing size must fit the 8-bit free-running indexes");
+
+public:
+   SampleRing() : head(0), tail(0) {}
+
+   // Producer side.  Returns false (and drops the item) if the consumer has fallen behind.
+   bool push(const T &item) {
+      uint8_t h = head;
+      if((uint8_t)(h - tail) == SIZE) {
+         return false;
+      }
+      buf[h & (SIZE - 1)] = item;
+      barrier();      // Item must be in the buffer before the consumer can see the new head
+      head = h + 1;
+      return true;
+   }
+
+   // Consumer side.  Returns false if there is nothing waiting.
+   bool pop(T &item) {
+      uint8_t t = tail;
+      if(t == head) {
+         return false;
+      }
+      item = buf[t & (SIZE - 1)];
+      barrier();      // Finish copying the item out before handing the slot back to the producer
+      tail = t + 1;
+      return true;
+   }
+
+   // Consumer side.  Throw away everything that is waiting.
+   void flush() {
+      tail = head;
+   }
+
+   uint8_t count() const {
+      return (uint8_t)(head - tail);
+   }
+
+   bool isEmpty() const {
+      return head == tail;
+   }
+
+private:
+   static inline void barrier() {
+      __asm__ __volatile__("" ::: "memory");
+   }
+
+   T buf[SIZE];
+   volatile uint8_t head;   // Next slot the producer writes
+   volatile uint8_t tail;   // Next slot the consumer reads
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*******************************************************************************************************
+Build switches shared by all of the scale's source files.
+
+Anything that changes how more than one file gets compiled lives here so every translation unit sees
+the same settings.  Comment/uncomment to select.
+*******************************************************************************************************/
+#ifndef SCALE_CONFIG_H
+#define SCALE_CONFIG_H
+
+// Which scale is being built comes from its platformio.ini environment, and what's different
+// about it (pins, display, HX711 rate, range) is in Board.h.
+#if defined(JEFF_SCALE) + defined(KITTY_SCALE) + defined(FIVE_KG_SCALE) != 1
+#error "Build one of JEFF_SCALE, KITTY_SCALE or FIVE_KG_SCALE (pick its environment in platformio.ini)"
+#endif
+
+// HIGH_RATE_MODE consumes every HX711 conversion (Board::HX711_SPS of them a second), averages them
+// down to the display rate, and hands the full-rate stream to the sample consumers (peak capture,
+// serial streaming).
+#define HIGH_RATE_MODE
+//#define SERIAL_STREAM_SAMPLES  // Print every conversion (ms, pounds) on the serial port in HIGH_RATE_MODE
+
+#define HX711_ISR_MODE       // Read the HX711 from a DOUT pin-change interrupt.  Comment out to poll with the HX711_ADC library.
+
+//#define FLOAT_WEIGHT_MATH  // Use the original soft-float weight math instead of the fixed-point pipeline
+
+// Filter chain between the raw HX711 counts and the weight (HX711_ISR_MODE only, see Filters.h)
+#define FILTER_MEDIAN_SIZE 3         // Median-of-N spike rejection.  Odd, 1 turns it off.
+#define FILTER_AVERAGE_SIZE 16       // Full moving average window once the reading has settled
+#define FILTER_STEP_CENTI 2          // Restart the average when the input jumps more than this (hundredths of a pound).  0 = never.
+#define FILTER_STEP_MIN_COUNTS 200   // ...but never for a jump of fewer counts than this (HX711 noise floor)
+#define FILTER_IIR_SHIFT 1           // First-order IIR after the average, alpha = 1/2^shift.  0 turns it off.
+
+// Stability detector (see Stability.h)
+#define STABLE_WINDOW_MS 1000        // Time window the peak-to-peak and mean cover
+#define STABLE_BLOCKS 4              // Window is tracked in this many time blocks (RAM vs. window granularity)
+#define STABLE_ENTER_CENTI 1         // Stable once peak-to-peak over the window is within this (hundredths of a pound)
+#define STABLE_EXIT_CENTI 3          // ...and unstable again once it grows past this
+#define STORE_WAIT_FOR_STABLE        // memStore() waits for a stable reading instead of storing a moving one
+#define STORE_STABLE_TIMEOUT_MS 5000 // Give up on the store if it hasn't settled by then
+
+// Task scheduler (see Scheduler.h)
+#define SCHEDULER_MAX_TASKS 8        // Static task table size
+//#define SCHEDULER_REPORT           // Print each task's load, WCET and missed deadlines on the serial port
+#define SCHEDULER_REPORT_MS 10000    // ...this often
+
+// Display sending (see DisplayQueue.h)
+#define DISPLAY_SLICE_US 500         // Most time one pass of loop() spends sending to the display (at least one command goes each pass)
+#define DISPLAY_QUEUE_SIZE 64        // Bytes of queued display commands.  Power of two, 64 to 128.
+
+// Weight readout in big digits (see BigDigits.h): 3 or 4 pages tall.  Undefine for the 2X text.
+#ifdef FIVE_KG_SCALE
+#define BIG_DIGITS 3                 // Pounds and kilograms both
+#else
+#define BIG_DIGITS 4                 // Pounds, with the kilograms in 2X under them
+#endif
+
+// Weight screen refresh (see setRefresh() in main.cpp).  Undefine for a fixed 200 ms.
+#define ADAPTIVE_REFRESH
+#define REFRESH_MOVING_MS 100        // ms between weight screen updates while the weight is moving
+#define REFRESH_STABLE_MS 500        // ...once it's stable (the shown weight is held then)
+#define REFRESH_IDLE_MS 2000         // ...once nothing has changed for IDLE_AFTER_MS, with the panel dimmed
+#define IDLE_AFTER_MS 60000
+#define IDLE_CONTRAST 0x08           // Dimmed panel.  OLED_CONTRAST below is full brightness.
+
+// OLED bus (see OledBus.h)
+#define OLED_CONTRAST 0x80           // What SSD1306Ascii's SH1106 setup sets
+#define FAST_OLED_BUS                // Drive the SPI/I2C registers ourselves instead of through SSD1306Ascii's transports
+// The bus clocks are the ones SSD1306Ascii's own transports use.  No panel has been timed any faster
+// yet, so only the way the bytes are sent changes.  Run the benchmark on the scale before raising them.
+#define OLED_SPI_HZ 4000000          // FIVE_KG_SCALE
+#define OLED_I2C_HZ 400000           // The others
+
+// Diagnostics.  All off for the scales as they're used: each one costs flash, RAM or both.  Turn
+// on the one that's needed while working on the firmware.  What the production build and each
+// of these actually take on the Nano hasn't been recorded yet - build each environment with
+// `pio run` and note the flash/RAM figures from its size, tools/ram_report.py and
+// tools/flash_report.py output.
+//#define RUN_BENCHMARKS             // Time the weight math, filter settling and number formatting at boot and print the results on the serial port
+//#define RAW_TRACE                  // 't' on the serial port streams raw HX711 conversions for offline replay (HX711_ISR_MODE only)
+//#define DISPLAY_BENCHMARK          // "Benchmark" in the menu times full-screen and single-field repaints on each bus setting
+//#define PROFILING                  // Per-section call counts and min/avg/max us, 'p' on the serial port (see Profiler.h)
+//#define MEMORY_STATS               // Stack painting and RAM use, 'm' on the serial port and "RAM" in the menu (see MemoryStats.h)
+
+// The native (host) build simulates the HX711 underneath our own acquisition, there's no HX711_ADC there
+#if !defined(ARDUINO) && !defined(HX711_ISR_MODE)
+#error "The native build needs HX711_ISR_MODE"
+#endif
+
+// The HX711_ADC library only hands back floats, so the fixed-point pipeline and raw traces
+// need our own raw-count acquisition.
+#ifndef HX711_ISR_MODE
+#undef RAW_TRACE
+#endif
+#if !defined(HX711_ISR_MODE) && !defined(FLOAT_WEIGHT_MATH)
+#define FLOAT_WEIGHT_MATH
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/*******************************************************************************************************
+Cooperative periodic task scheduler.
+
+loop() used to do everything in a fixed order with its own millis() comparisons.  Instead, each job
+(acquisition, the knob, menu/weight rendering, battery) is a task with a period and a priority, and
+loop() just calls runNext():
+
+   - runNext() runs the one task that is due and has the best (lowest number) priority, then returns.
+     Since the choice is made again on every call, a due acquisition task always goes ahead of any
+     rendering work that is waiting.
+   - Deadlines are compared as (int32_t)(now - due) so they keep working when millis() wraps.
+   - Each task keeps its worst-case execution time and the number of deadlines it missed (started
+     a full period or more late).  report() prints them along with where the loop's time went.
+
+Everything is statically allocated, SCHEDULER_MAX_TASKS entries (see ScaleConfig.h).  Tasks can't be
+removed, and nothing preempts a task that is running - a task that blocks shows up in its WCET.
+A task's period can be changed while it runs (setPeriod()), which is how the weight screen slows
+down once the reading has settled.
+*******************************************************************************************************/
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "ScaleConfig.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 6
+#endif
+
+struct SchedulerTask {
+   void (*run)();
+   const __FlashStringHelper *name;
+   uint16_t period;          // ms between runs
+   uint8_t priority;         // 0 is the most important
+   uint32_t due;             // millis() when it should next run
+   uint32_t wcet;            // Longest run so far, us
+   uint32_t busy;            // Time spent running since the last report, us
+   uint16_t runs;            // Runs since the last report
+   uint16_t missed;          // Runs that started a full period or more late
+};
+
+class Scheduler {
+public:
+   Scheduler();
+   int8_t addTask(void (*run)(), const __FlashStringHelper *name, uint16_t periodMs, uint8_t priority);   // Returns the task id, -1 if full
+   void setPeriod(int8_t id, uint16_t periodMs);   // From now on.  A shorter period brings the next run forward.
+   bool runNext();                           // Run the most important due task.  False if nothing was due.
+   void report(Print &out);                  // Per-task stats since the last report, then start a new interval
+   uint8_t taskCount() const { return numTasks; }
+   const SchedulerTask &task(uint8_t id) const { return tasks[id]; }
+
+private:
+   SchedulerTask tasks[SCHEDULER_MAX_TASKS];
+   uint8_t numTasks;
+   uint32_t intervalStart;                   // micros() at the last report
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*******************************************************************************************************
+Character-cell shadow of the OLED, in front of ScaleDisplay.
+
+Every screen starts with clear() and prints the whole thing again.  SSD1306Ascii has no frame buffer
+(the one that does costs 1 KB of RAM), so each of those is a full-panel wipe plus every character,
+even when most of them were already there.  ShadowDisplay has the same calls as ScaleDisplay and
+keeps a small grid of what's on the panel, one cell per 2X character position (12 pixels by two
+pages): 4 rows of 10, plus the 8-pixel strip on the right.  That's 44 bytes, 8 more for the cells
+touched since the last clear(), and 8 for the cells still to send.
+
+   - clear() doesn't send anything.  It starts a new frame - every cell is expected to be blank
+     unless something is written into it before the next flush().
+   - A 2X character on the grid only goes in its cell.  If that's a change the cell is marked to be
+     sent, and service() sends it later.  Reprinting the same screen sends nothing at all.
+   - flush() marks the cells that had something on them and weren't written this frame to be
+     blanked.  loop() calls it after every task, and anything that sits in a wait loop calls it
+     before waiting.
+   - 1X text, 2X text off the grid and big digits are queued for the panel as they come.  The cells
+     under it are marked as holding something we don't track, so they get rewritten or blanked next
+     time.
+
+So the grid is the display queue for everything on it: service() puts as many of the cells waiting
+to be sent into the DisplayQueue as it has room for, then has it send a slice.  Only the text off
+the grid ever has to wait for room.  When the queue turns it away (DisplayQueue.h) write() returns
+0 and drops() counts one more.  Whoever was drawing checks drops() and draws the rest on a later
+pass:
+
+   - A frame that's been cleared and not yet flushed waits for them: flush() doesn't blank
+     anything until it's been drawn all the way through.  Picking up a frame part way through is
+     resume(), which goes on with the same frame, or clear() to start it again.
+   - A DisplayField only counts the characters that got out as shown (DisplayField.h).
+
+The cursor moves are tracked too, so a run of changed characters costs one setCursor().
+*******************************************************************************************************/
+#ifndef SHADOW_DISPLAY_H
+#define SHADOW_DISPLAY_H
+
+#include <Arduino.h>
+#include "DisplayQueue.h"
+
+const uint8_t SHADOW_ROWS = 4;         // 2X rows, two pages each
+const uint8_t SHADOW_COLS = 11;        // 10 2X characters, then the strip at the right edge
+
+class ShadowDisplay : public Print {
+public:
+   ShadowDisplay(DisplayQueue &panel);
+   void begin();
+   void clear();                   // Start a new frame, nothing is sent yet
+   uint8_t frame() { return frames; }   // Counts clear()s, so a screen can tell it's still the one up
+   void resume();                  // Go on drawing a frame that was cut short (see drops())
+   void flush();                   // Blank whatever this frame didn't write over
+   bool service(uint16_t budgetUs);   // Queue the cells waiting to go, then send a slice (DisplayQueue::service())
+   void drain();                   // Send everything now
+   uint8_t drops() { return dropped; }   // Counts writes the queue had no room for
+   void set1X();
+   void set2X();
+   void setCursor(uint8_t col, uint8_t row);
+   void clearField(uint8_t col, uint8_t row, uint8_t n);
+   void clearToEOL();
+   void setContrast(uint8_t value) { panel.setContrast(value); }   // Not part of the frame, goes with the next slice
+   uint8_t fontRows() { return magnify; }
+   uint8_t fieldWidth(uint8_t n);
+   size_t write(uint8_t c);
+   using Print::write;
+   #ifdef BIG_DIGITS
+   bool writeBig(uint8_t glyph, uint8_t oldGlyph);   // At the cursor, see BigDigits.h.  False if it has to be tried again.
+   #endif
+
+private:
+   bool send(uint8_t c, uint8_t col, uint8_t row, uint8_t size);
+   bool usePanelSize(uint8_t size);
+   void sendWaiting();
+   bool anyWaiting();
+   bool drop();
+   bool claimCells(uint8_t col, uint8_t row, uint8_t width, uint8_t pages, bool written);
+   bool blankCells(uint8_t gridRow, uint8_t first, uint8_t n);
+   bool isTouched(uint8_t gridRow, uint8_t gridCol) { return touched[gridRow] & (1 << gridCol); }
+   void touch(uint8_t gridRow, uint8_t gridCol) { touched[gridRow] |= 1 << gridCol; }
+   bool isWaiting(uint8_t gridRow, uint8_t gridCol) { return waiting[gridRow] & (1 << gridCol); }
+   void setCell(uint8_t gridRow, uint8_t gridCol, char c);
+
+   DisplayQueue &panel;                     // Where the changes go (see DisplayQueue.h)
+   char cells[SHADOW_ROWS][SHADOW_COLS];   // What's on the panel in each cell, or will be once it's sent
+   uint16_t touched[SHADOW_ROWS];           // Bit per cell, written (or kept) since clear()
+   uint16_t waiting[SHADOW_ROWS];           // Bit per cell, changed and not yet sent (on the panel it's anything)
+   uint8_t frames;
+   uint8_t dropped;
+   bool pending;                            // Some cells wait on flush() to be blanked
+   bool cutShort;                           // Something this frame was turned away, flush() waits for the rest
+   uint8_t col;                             // Where the next character goes, pixels
+   uint8_t row;                             // Pages
+   uint8_t magnify;
+   uint8_t panelCol;                        // Where the panel's own cursor is.  0xFF = don't know.
+   uint8_t panelRow;
+   uint8_t panelMagnify;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*******************************************************************************************************
+Stability detector.
+
+Keeps peak-to-peak and the mean of the weight over a sliding time window and turns that into a
+stable/unstable state with hysteresis:
+
+   unstable -> stable     once the window is full and peak-to-peak is within the "enter" limit
+   stable   -> unstable   once peak-to-peak grows past the (larger) "exit" limit, or the window's mean
+                          has crept further than that from where it was when it became stable
+
+Storing every sample in the window would cost too much RAM at the higher sample rates, so the window
+is split into STABLE_BLOCKS time blocks.  Each block only keeps min, max, count and sum for the samples
+that landed in it.  When a block's time is up the oldest block is cleared and reused.  The window
+therefore covers between (STABLE_BLOCKS-1)/STABLE_BLOCKS and all of STABLE_WINDOW_MS, which is plenty
+for judging whether a load has settled.
+
+The decision is on peak-to-peak alone.  It's what the display shows as the last digit wandering, it
+comes straight from the blocks' min and max with no arithmetic per sample, and one spike is enough to
+end a stable reading, which a standard deviation over the window would average away.
+
+Weights are Q16.16 pounds (see WeightMath.h).  The sums are kept as offsets from a reference weight
+(the first reading after a reset) so they stay exact in integers.  Offsets are clamped to +/-64 lb,
+well past the range of any of our load cells.
+*******************************************************************************************************/
+#ifndef STABILITY_H
+#define STABILITY_H
+
+#include <stdint.h>
+#include "ScaleConfig.h"
+#include "WeightMath.h"
+
+#ifndef STABLE_WINDOW_MS
+#define STABLE_WINDOW_MS 1000
+#endif
+#ifndef STABLE_BLOCKS
+#define STABLE_BLOCKS 4
+#endif
+#ifndef STABLE_ENTER_CENTI
+#define STABLE_ENTER_CENTI 1
+#endif
+#ifndef STABLE_EXIT_CENTI
+#define STABLE_EXIT_CENTI 3
+#endif
+
+static_assert(STABLE_BLOCKS >= 2 && STABLE_BLOCKS <= 8, "STABLE_BLOCKS must be 2 to 8");
+static_assert(STABLE_EXIT_CENTI >= STABLE_ENTER_CENTI, "Exit limit must not be below the enter limit");
+
+enum StabilityEvent {
+   STABILITY_NO_CHANGE = 0,
+   STABILITY_BECAME_STABLE,
+   STABILITY_BECAME_UNSTABLE
+};
+
+class StabilityDetector {
+public:
+   StabilityDetector();
+   StabilityEvent update(q16_t value, uint32_t now);   // Add one reading, timestamped in ms
+   void reset();
+
+   bool isStable() const { return stable; }
+   bool isWindowFull() const { return blocksFilled >= STABLE_BLOCKS - 1; }
+   q16_t peakToPeak() const;     // Over the window, Q16.16 pounds
+   q16_t mean() const;           // Over the window, Q16.16 pounds
+   uint16_t sampleCount() const;
+
+private:
+   struct Block {
+      q16_t minVal;
+      q16_t maxVal;
+      int32_t sum;               // Sum of (value - reference)
+      uint8_t count;
+   };
+
+   void clearWindow();
+   void clearBlock(Block &block);
+   void advanceBlock();
+   bool hasDrifted() const;
+
+   Block blocks[STABLE_BLOCKS];
+   q16_t reference;
+   q16_t stableLevel;            // Mean when it last became stable
+   uint32_t blockStart;
+   uint8_t current;
+   uint8_t blocksFilled;         // Blocks closed since the last reset
+   bool started;
+   bool stable;
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*******************************************************************************************************
+The calibration constant and the stored weights, kept in EEPROM as a log.
+
+They used to each have a fixed spot (the cal at 0, M0-M9 four bytes apart after it), so every store to
+M0 wore the same four cells, and a busy shift of stores goes through a cell's 100,000 writes a lot
+sooner than the rest of the EEPROM's.  Now a value goes in as a new record after the last one:
+
+   value     4 bytes   The float bits, as they were always kept
+   tag       2 bytes   12-bit sequence number, 4-bit key (which value it is, LOG_CAL_VAL etc.)
+   crc       2 bytes   CRC-16/CCITT of the value and tag
+
+in LOG_SLOTS 8-byte slots from LOG_START to the end of the 1 KB EEPROM, going round to the first slot
+after the last.  The latest record of each key is its value.  A record that's been superseded is
+garbage, and just gets written over when the log comes round to it.
+
+begin() reads all the slots once at power on, keeps the ones whose CRC checks, and remembers which slot
+holds the latest of each key (the highest sequence number, counting round at 4096) and where the next
+record goes.  That's the only full read, about 1 KB of EEPROM reads and CRCs, a few ms.  A record
+half written when the power went doesn't check, so the one before it still counts.
+
+So nothing is lost by going round, the head never gets to the only copy of a value: if the slot
+after it still holds the latest of some other key, that's copied to the head first (at most once a
+lap for each key).  write() doesn't write a value that's the same as the one already stored, so
+clearing memories that are already clear costs nothing.
+
+Every slot is written once a lap, so the number of laps is each cell's wear.  It's kept in the log
+too (LOG_LAPS), and 'e' on the serial port reports it.  With 122 slots and 12 keys a lap takes at
+least 110 stores, so a cell wears 110 times slower than when every store to M0 went to the same
+place.  A store writes 8 bytes instead of 4, about 27 ms of EEPROM writes instead of 14.
+
+Units that already have values keep them: a key with no record yet reads from its old fixed spot
+(key * 4, the old layout, which LOG_START leaves alone), and its first write moves it into the log.
+*******************************************************************************************************/
+#ifndef VALUE_LOG_H
+#define VALUE_LOG_H
+
+#include <Arduino.h>
+
+// Keys.  A key's old fixed spot was key * 4.
+const uint8_t LOG_CAL_VAL = 0;
+const uint8_t LOG_MEMORY = 1;                          // M0-M9 are LOG_MEMORY + 0-9
+const uint8_t LOG_MEMORIES = 10;
+const uint8_t LOG_LAPS = LOG_MEMORY + LOG_MEMORIES;    // Times the log has gone round (not in the old layout)
+const uint8_t LOG_KEYS = LOG_LAPS + 1;
+
+const int EEPROM_BYTES = 1024;                         // ATmega328
+const int LOG_START = 48;                              // After the old layout's 44 bytes
+
+struct LogRecord {
+   uint32_t value;
+   uint16_t tag;             // Sequence number << 4 | key
+   uint16_t crc;
+};
+
+const uint8_t LOG_SLOTS = (EEPROM_BYTES - LOG_START) / sizeof(LogRecord);
+
+class ValueLog {
+public:
+   static void begin();                               // Find the latest records, before any read()
+   static uint32_t read(uint8_t key);
+   static bool write(uint8_t key, uint32_t value);    // false if it was already that
+   static void report(Print &out);                    // One line, for the serial port
+
+private:
+   static void append(uint8_t key, uint32_t value);
+   static void writeRecord(uint8_t key, uint32_t value);
+   static uint8_t keyAt(uint8_t slot);
+
+   static uint8_t latest[LOG_KEYS];     // Slot of each key's latest record, NO_SLOT if it hasn't one
+   static uint8_t head;                 // Where the next record goes
+   static uint16_t nextSeq;
+   static uint16_t written;             // Records written since power on, copies included
+   static uint16_t skipped;             // Writes skipped since power on, the value was already stored
+};
+
+#endif
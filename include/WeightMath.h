@@ -0,0 +1,75 @@
+/*******************************************************************************************************
+Weight math for the scale.
+
+The Nano has no FPU, so every float add/multiply/divide is a soft-float library call.  By default the
+weight is carried as fixed point the whole way from the raw HX711 counts to the display:
+
+   raw counts - tare offset      -> net counts                (int32)
+   net counts * 1/calVal         -> pounds, Q16.16            (one 32x32->64 multiply and a shift)
+   pounds * 0.45359237           -> kilograms, Q16.16         (same, with the exact lb->kg factor)
+   Q16.16                        -> hundredths for display    (one multiply and a shift)
+
+The values the user sees and edits (stored memories, calVal, the calibration reference weight) are
+kept in hundredths, so x.yy values are exact and never need rounding for display.
+
+Define FLOAT_WEIGHT_MATH (see ScaleConfig.h) to go back to plain floats for everything.  The types
+below switch with it so the rest of the code reads the same either way.
+*******************************************************************************************************/
+#ifndef WEIGHT_MATH_H
+#define WEIGHT_MATH_H
+
+#include <stdint.h>
+#include "ScaleConfig.h"
+
+typedef int32_t q16_t;                       // 16.16 fixed point
+const uint8_t Q16_SHIFT = 16;
+const q16_t Q16_ONE = (q16_t)1 << Q16_SHIFT;
+
+const int32_t LB_TO_KG_Q30 = 487041099;      // 0.45359237 * 2^30, rounded
+
+#ifdef FLOAT_WEIGHT_MATH
+typedef float weight_t;                      // Live weight in pounds
+typedef float decimal_t;                     // x.yy values the user sees (memories, calVal, ref weight)
+const decimal_t DECIMAL_ONE = 1.0;
+const decimal_t DECIMAL_HUNDREDTH = 0.01;
+#else
+typedef q16_t weight_t;                      // Live weight in pounds, Q16.16
+typedef int32_t decimal_t;                   // x.yy values the user sees, in hundredths
+const decimal_t DECIMAL_ONE = 100;
+const decimal_t DECIMAL_HUNDREDTH = 1;
+#endif
+
+// Precomputed reciprocal of the calibration factor so converting a reading is a multiply
+// instead of a divide.  pounds(Q16.16) = (netCounts * recip) >> shift
+struct WeightScale {
+   int32_t recip;
+   uint8_t shift;
+};
+
+void setWeightScale(WeightScale &scale, int32_t calCenti);   // calCenti is counts per pound, in hundredths
+q16_t countsToPounds(int32_t netCounts, const WeightScale &scale);    // Saturates at the Q16.16 range
+q16_t poundsToKilogramsQ16(q16_t pounds);
+int32_t q16ToCenti(q16_t value);                             // Rounded to the nearest hundredth
+int32_t calFromReference(int32_t netCounts, int32_t refCenti);
+
+// EEPROM values are kept in the original float layout so units can switch between the float
+// and fixed-point builds without losing their calibration or stored weights.
+int32_t centiFromFloatBits(uint32_t bits);
+uint32_t floatBitsFromCenti(int32_t centi);
+
+// Same calls for either build so loop() and the menus don't need to care which one is in use
+#ifdef FLOAT_WEIGHT_MATH
+inline weight_t poundsToKilograms(weight_t pounds) { return pounds * 0.45359237; }
+inline decimal_t weightToDecimal(weight_t pounds) { return pounds; }
+inline q16_t weightToQ16(weight_t pounds) { return (q16_t)(pounds * Q16_ONE); }
+inline weight_t q16ToWeight(q16_t pounds) { return pounds / (float)Q16_ONE; }
+inline int32_t decimalToCenti(decimal_t val) { return (int32_t)(val * 100 + (val < 0 ? -0.5 : 0.5)); }
+#else
+inline weight_t poundsToKilograms(weight_t pounds) { return poundsToKilogramsQ16(pounds); }
+inline decimal_t weightToDecimal(weight_t pounds) { return q16ToCenti(pounds); }
+inline q16_t weightToQ16(weight_t pounds) { return pounds; }
+inline weight_t q16ToWeight(q16_t pounds) { return pounds; }
+inline int32_t decimalToCenti(decimal_t val) { return val; }
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+/*******************************************************************************************************
+Just enough of the Arduino core for the scale firmware to build and run on a PC ([env:native]).
+
+Time is simulated (see NativeSim.h).  Every micros()/millis() read moves the clock on a little, the
+way a real loop takes time, so busy-waits finish.  delay() moves it on by the whole delay.  Anything
+printed on Serial goes to stdout, with the simulated time at the start of each line.
+*******************************************************************************************************/
+#ifndef ARDUINO_SIM_H
+#define ARDUINO_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <cstdlib>
+#include <cmath>
+
+using std::abs;
+using std::round;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define A7 21
+
+// No separate flash on the PC, so PROGMEM data is just data
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strcmp_P strcmp
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+class Print {
+public:
+   virtual ~Print() {}
+   virtual size_t write(uint8_t c) = 0;
+   size_t write(const uint8_t *buf, size_t len);
+   size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+   size_t print(const char *str);
+   size_t print(const __FlashStringHelper *str);
+   size_t print(char c);
+   size_t print(int n, int base = 10);
+   size_t print(unsigned int n, int base = 10);
+   size_t print(long n, int base = 10);
+   size_t print(unsigned long n, int base = 10);
+   size_t print(double n, int digits = 2);
+
+   size_t println();
+   template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+   template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+// Serial port, printed on stdout
+class SimSerial : public Print {
+public:
+   void begin(unsigned long baud) {}
+   int available();
+   int read();
+   void flush() {}
+   size_t write(uint8_t c);
+   using Print::write;
+   operator bool() { return true; }
+};
+extern SimSerial Serial;
+
+#endif
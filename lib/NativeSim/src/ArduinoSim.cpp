@@ -0,0 +1,157 @@
+/*******************************************************************************************************
+Simulated Arduino core: clock, pins, Print and Serial.  See Arduino.h and NativeSim.h.
+*******************************************************************************************************/
+#include "Arduino.h"
+#include "NativeSim.h"
+
+const uint32_t CLOCK_READ_US = 2;   // What a trip round a polling loop costs on the simulated Nano
+const int BATTERY_READING = 921;    // analogRead() of the battery divider, about 9 V
+
+SimSerial Serial;
+
+static char serialIn[256];
+static uint16_t serialInHead = 0;
+static uint16_t serialInTail = 0;
+
+unsigned long micros() {
+   simAdvance(CLOCK_READ_US);
+   return (unsigned long)(uint32_t)simTimeUs();
+}
+
+unsigned long millis() {
+   simAdvance(CLOCK_READ_US);
+   return (unsigned long)(uint32_t)(simTimeUs() / 1000);
+}
+
+void delay(unsigned long ms) {
+   simAdvance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+   simAdvance(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+}
+
+int digitalRead(uint8_t pin) {
+   return HIGH;
+}
+
+int analogRead(uint8_t pin) {
+   return BATTERY_READING;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+   return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+//************************************************************************************
+// Print
+//************************************************************************************
+size_t Print::write(const uint8_t *buf, size_t len) {
+   size_t n = 0;
+   while(len--) {
+      n += write(*buf++);
+   }
+   return n;
+}
+
+size_t Print::print(const char *str) {
+   return write(str);
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+   return write((const char *)str);
+}
+
+size_t Print::print(char c) {
+   return write((uint8_t)c);
+}
+
+size_t Print::print(int n, int base) {
+   return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+   return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+   if(base == 10 && n < 0) {
+      return print('-') + print((unsigned long)-n, base);
+   }
+   return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+   char buf[8 * sizeof(long) + 1];
+   char *p = &buf[sizeof(buf) - 1];
+   *p = 0;
+   if(base < 2) {
+      base = 10;
+   }
+   do {
+      int digit = n % base;
+      *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+      n /= base;
+   } while(n);
+   return write(p);
+}
+
+size_t Print::print(double n, int digits) {
+   char buf[32];
+   snprintf(buf, sizeof(buf), "%.*f", digits, n);
+   return write(buf);
+}
+
+size_t Print::println() {
+   return write((uint8_t)'\r') + write((uint8_t)'\n');
+}
+
+//************************************************************************************
+// Serial.  Output goes to stdout with the simulated time in front of each line.
+//************************************************************************************
+size_t SimSerial::write(uint8_t c) {
+   static bool lineStart = true;
+   if(c == '\r') {
+      return 1;
+   }
+   if(lineStart) {
+      uint64_t us = simTimeUs();
+      printf("[%6lu.%03lu] ", (unsigned long)(us / 1000000), (unsigned long)(us / 1000 % 1000));
+      lineStart = false;
+   }
+   putchar(c);
+   if(c == '\n') {
+      lineStart = true;
+   }
+   return 1;
+}
+
+int SimSerial::available() {
+   return (uint16_t)(serialInHead - serialInTail) % sizeof(serialIn);
+}
+
+int SimSerial::read() {
+   if(serialInHead == serialInTail) {
+      return -1;
+   }
+   char c = serialIn[serialInTail];
+   serialInTail = (serialInTail + 1) % sizeof(serialIn);
+   return (uint8_t)c;
+}
+
+void simSerialInput(const char *text) {
+   while(*text) {
+      uint16_t next = (serialInHead + 1) % sizeof(serialIn);
+      if(next == serialInTail) {
+         return;   // Full, same as a real UART dropping bytes
+      }
+      serialIn[serialInHead] = *text++;
+      serialInHead = next;
+   }
+}
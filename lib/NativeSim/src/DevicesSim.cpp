@@ -0,0 +1,533 @@
+/*******************************************************************************************************
+Simulated scale devices: the HX711 behind Hx711Isr, and the display, knob, timer and EEPROM behind
+Hal.h.  See NativeSim.h.
+*******************************************************************************************************/
+#include "Arduino.h"
+#include "ScaleConfig.h"
+#include "Board.h"
+#include "Hx711Isr.h"
+#include "NativeSim.h"
+#include "BigDigits.h"
+
+//************************************************************************************
+// Clock.  Conversions and timer ticks that come due while time moves on are run in
+// order, the way their interrupts would have been.
+//************************************************************************************
+static uint64_t nowUs = 0;
+static bool advancing = false;      // A conversion or tick reading the clock doesn't move it again
+
+static bool hx711Running = false;
+static uint64_t nextConversionUs;
+const uint32_t CONVERSION_US = 1000000UL / Board::HX711_SPS;
+
+const uint32_t DEVICE_POLL_US = 2;  // Polling a device takes time too, so loops that only poll still finish
+
+static void (*timerIsr)() = 0;
+static unsigned long timerPeriodUs;
+static uint64_t nextTickUs;
+
+static void (*clockHook)() = 0;
+
+uint64_t simTimeUs() {
+   return nowUs;
+}
+
+void simSetClockHook(void (*hook)()) {
+   clockHook = hook;
+}
+
+void simAdvance(uint32_t us) {
+   if(advancing) {
+      return;
+   }
+   advancing = true;
+   uint64_t target = nowUs + us;
+   for(;;) {
+      uint64_t next = target + 1;
+      if(hx711Running && nextConversionUs < next) {
+         next = nextConversionUs;
+      }
+      if(timerIsr && nextTickUs < next) {
+         next = nextTickUs;
+      }
+      if(next > target) {
+         break;
+      }
+      nowUs = next;
+      if(hx711Running && next == nextConversionUs) {
+         Hx711Isr::handleInterrupt();
+      }
+      if(timerIsr && next == nextTickUs) {
+         timerIsr();
+         nextTickUs += timerPeriodUs;
+      }
+   }
+   nowUs = target;
+   if(clockHook) {
+      clockHook();   // Still inside advancing, so the hook's own clock reads don't recurse
+   }
+   advancing = false;
+}
+
+//************************************************************************************
+// HX711.  Each conversion is the load times the sensitivity, on top of the bridge's
+// zero offset, plus some noise.
+//************************************************************************************
+const int32_t ZERO_COUNTS = 84000;   // Unloaded bridge offset.  Anything non-zero so the tare has work to do.
+
+static double loadPounds = 0;
+static double countsPerPound = 47672.54;
+static int32_t noiseCounts = 40;
+static uint32_t noiseSeed = 12345;
+static uint64_t lostUntilUs = 0;
+
+// Trace playback.  Before the trace starts the first conversion is repeated at the
+// normal rate, after it ends the last one is.
+static const SimTraceSample *trace = 0;
+static uint32_t traceCount = 0;
+static uint32_t traceIndex = 0;
+static uint64_t traceStartUs;
+
+static uint64_t traceTimeUs(uint32_t i) {
+   return traceStartUs + (uint64_t)(trace[i].ms - trace[0].ms) * 1000;
+}
+
+void simPlayTrace(const SimTraceSample *samples, uint32_t count, uint32_t startMs) {
+   trace = count ? samples : 0;
+   traceCount = count;
+   traceIndex = 0;
+   traceStartUs = (uint64_t)startMs * 1000;
+}
+
+// What the next conversion reads
+static int32_t conversionRaw() {
+   if(trace) {
+      if(traceIndex < traceCount && nowUs >= traceTimeUs(traceIndex)) {
+         return trace[traceIndex++].raw;
+      }
+      return trace[traceIndex < traceCount ? 0 : traceCount - 1].raw;
+   }
+   noiseSeed = noiseSeed * 1103515245UL + 12345;   // Same LCG as the benchmarks, repeatable runs
+   int32_t noise = noiseCounts ? (int32_t)((noiseSeed >> 8) % (2 * noiseCounts + 1)) - noiseCounts : 0;
+   int32_t raw = ZERO_COUNTS + (int32_t)lround(loadPounds * countsPerPound) + noise;
+   if(raw > 0x7FFFFF) {
+      raw = 0x7FFFFF;        // The HX711 saturates at full scale
+   } else if(raw < -0x800000) {
+      raw = -0x800000;
+   }
+   return raw;
+}
+
+// The HX711's own rate, or the trace's timestamps while it plays
+static void scheduleConversion() {
+   nextConversionUs = nowUs + CONVERSION_US;
+   if(trace && traceIndex < traceCount) {
+      uint64_t t = traceTimeUs(traceIndex);
+      if(t <= nextConversionUs) {
+         nextConversionUs = t > nowUs ? t : nowUs;
+      }
+   }
+}
+
+SampleRing<Hx711Sample, HX711_RING_SIZE> Hx711Isr::ring;
+volatile uint32_t Hx711Isr::capturedCount = 0;
+volatile uint16_t Hx711Isr::overrunCount = 0;
+
+void simSetLoad(double pounds) {
+   loadPounds = pounds;
+}
+
+void simSetCountsPerPound(double counts) {
+   countsPerPound = counts;
+}
+
+void simSetNoise(int32_t counts) {
+   noiseCounts = counts;
+}
+
+void simLoseConversions(uint32_t ms) {
+   lostUntilUs = nowUs + (uint64_t)ms * 1000;
+}
+
+void Hx711Isr::begin() {
+   if(!hx711Running) {
+      hx711Running = true;
+      scheduleConversion();
+   }
+}
+
+bool Hx711Isr::read(Hx711Sample &sample) {
+   simAdvance(DEVICE_POLL_US);
+   return ring.pop(sample);
+}
+
+uint8_t Hx711Isr::waiting() {
+   return ring.count();
+}
+
+uint32_t Hx711Isr::captured() {
+   return capturedCount;
+}
+
+uint16_t Hx711Isr::overruns() {
+   return overrunCount;
+}
+
+void Hx711Isr::handleInterrupt() {
+   if(nowUs < lostUntilUs) {
+      scheduleConversion();
+      return;
+   }
+   Hx711Sample sample;
+   sample.raw = conversionRaw();
+   sample.time = (uint32_t)(nowUs / 1000);
+   capturedCount++;
+   if(!ring.push(sample)) {
+      overrunCount++;
+   }
+   scheduleConversion();
+}
+
+//************************************************************************************
+// Display.  A grid of 6-pixel character cells, 8 rows of 21.  A 2X character takes
+// a 2x2 block of cells - the top left holds the character and the rest are marked so
+// the dump prints it once, at its normal width.
+//
+// Bus traffic is counted the way SSD1306Ascii sends it: 3 command bytes to move the
+// cursor to a column and page, then one data byte per pixel column per page.  Each
+// byte takes time on the bus, during which conversions and timer ticks carry on.
+//
+// How long depends on the transport (see OledBus.h).  The library's SPI spends most of
+// each byte in digitalWrite()s, ours only the time on the wire.  I2C costs about three
+// bytes' time per transfer (start, address, control byte, stop).  The library makes
+// every command a transfer, and every character's data on a page; ours keeps going
+// while the bytes are the same kind.
+//************************************************************************************
+const uint8_t DISPLAY_WIDTH = 128;
+const uint8_t DISPLAY_ROWS = 8;
+const uint8_t CELL_WIDTH = 6;        // 5x7 font plus one pixel of spacing
+const uint8_t CELLS = DISPLAY_WIDTH / CELL_WIDTH;
+const char COVERED_RIGHT = 1;       // Right half of a 2X character, left out of the dump
+const char COVERED_BELOW = 2;       // Bottom left of a 2X character, dumped as a blank
+
+static char screen[DISPLAY_ROWS][CELLS];
+static uint8_t cursorCol = 0;        // Pixels
+static uint8_t cursorRow = 0;
+static uint8_t magnify = 1;
+static uint8_t contrast = OLED_CONTRAST;
+static bool screenChanged = false;   // Anything sent to the display since simDisplayChanged()
+static uint32_t busBytes = 0;
+const uint8_t CURSOR_BYTES = 3;
+
+struct SimBus {
+   const char *name;
+   uint32_t hz;                      // 0 = the library's transport
+};
+
+// Same lists as the benchmark's in Hal.cpp
+static const SimBus spiBusSettings[] = {
+   { "library", 0 },
+   { "spi 4MHz", 4000000 },
+   { "spi 8MHz", 8000000 }
+};
+static const SimBus i2cBusSettings[] = {
+   { "library", 0 },
+   { "i2c 400k", 400000 },
+   { "i2c 800k", 800000 }
+};
+static const SimBus *const busSettings = Board::OLED_SPI ? spiBusSettings : i2cBusSettings;
+const uint8_t BUS_SETTINGS = 3;
+
+// SPI, then I2C
+const uint32_t LIBRARY_HZ = Board::OLED_SPI ? 4000000 : 400000;
+const uint32_t LIBRARY_BYTE_NS = Board::OLED_SPI ? 12000 : 0;   // Three digitalWrite()s and a SPI transaction
+const uint32_t BYTE_NS = Board::OLED_SPI ? 500 : 0;             // Our loop around SPDR
+const uint8_t BYTE_CLOCKS = Board::OLED_SPI ? 8 : 9;            // Eight bits, and the ACK
+#ifdef FAST_OLED_BUS
+static const SimBus configuredBus = Board::OLED_SPI ? SimBus{ "spi", OLED_SPI_HZ } : SimBus{ "i2c", OLED_I2C_HZ };
+#else
+static const SimBus configuredBus = busSettings[0];
+#endif
+static SimBus bus = configuredBus;
+
+enum BusTransfer { NO_TRANSFER, COMMAND_TRANSFER, DATA_TRANSFER };
+static BusTransfer openTransfer = NO_TRANSFER;   // Ours keeps one going
+static uint32_t busNs = 0;                       // Time on the bus not yet taken off the clock
+
+static void busTime(uint32_t ns) {
+   busNs += ns;
+   simAdvance(busNs / 1000);
+   busNs %= 1000;
+}
+
+static uint32_t byteNs() {
+   uint32_t hz = bus.hz ? bus.hz : LIBRARY_HZ;
+   return BYTE_CLOCKS * (1000000000UL / hz) + (bus.hz ? BYTE_NS : LIBRARY_BYTE_NS);
+}
+
+static uint32_t transferNs() {
+   if(Board::OLED_SPI) {
+      return 0;                      // Chip select, part of the byte time
+   }
+   return 3 * byteNs();
+}
+
+// A transfer of this kind, n bytes.  The library splits data into a transfer per character (runs).
+static void busTransfer(BusTransfer kind, uint32_t bytes, uint32_t runs = 1) {
+   busBytes += bytes;
+   if(!bus.hz) {
+      busTime((kind == COMMAND_TRANSFER ? bytes : runs) * transferNs() + bytes * byteNs());
+      return;
+   }
+   if(openTransfer != kind) {
+      busTime(transferNs());
+      openTransfer = kind;
+   }
+   busTime(bytes * byteNs());
+}
+
+uint8_t ScaleDisplay::busSettings() {
+   return BUS_SETTINGS;
+}
+
+const __FlashStringHelper *ScaleDisplay::useBusSetting(uint8_t n) {
+   bus = ::busSettings[n];
+   openTransfer = NO_TRANSFER;
+   clear();
+   return F(bus.name);
+}
+
+uint32_t simDisplayBusBytes() {
+   return busBytes;
+}
+
+bool simDisplayChanged() {
+   bool changed = screenChanged;
+   screenChanged = false;
+   return changed;
+}
+
+// Blank the cells on the grid, sending it if asked
+static void blankCells(uint8_t col, uint8_t row, uint8_t cells, bool send) {
+   screenChanged = true;
+   uint8_t end = col / CELL_WIDTH + cells < CELLS ? col + cells * CELL_WIDTH : DISPLAY_WIDTH;
+   for(uint8_t r = row; r < row + magnify && r < DISPLAY_ROWS; r++) {
+      for(uint8_t c = col / CELL_WIDTH; c < col / CELL_WIDTH + cells && c < CELLS; c++) {
+         screen[r][c] = ' ';
+      }
+      if(send) {
+         busTransfer(COMMAND_TRANSFER, CURSOR_BYTES);
+         busTransfer(DATA_TRANSFER, end - col, (end - col + CELL_WIDTH - 1) / CELL_WIDTH);
+      }
+   }
+}
+
+void ScaleDisplay::begin() {
+   contrast = OLED_CONTRAST;
+   bus = configuredBus;
+   openTransfer = NO_TRANSFER;
+   clear();
+}
+
+void ScaleDisplay::clear() {
+   memset(screen, ' ', sizeof(screen));
+   screenChanged = true;
+   for(uint8_t r = 0; r < DISPLAY_ROWS; r++) {
+      busTransfer(COMMAND_TRANSFER, CURSOR_BYTES);
+      busTransfer(DATA_TRANSFER, DISPLAY_WIDTH);
+   }
+   cursorCol = 0;
+   cursorRow = 0;
+}
+
+void ScaleDisplay::set1X() {
+   magnify = 1;
+}
+
+void ScaleDisplay::set2X() {
+   magnify = 2;
+}
+
+void ScaleDisplay::setCursor(uint8_t col, uint8_t row) {
+   busTransfer(COMMAND_TRANSFER, CURSOR_BYTES);
+   cursorCol = col;
+   cursorRow = row;
+}
+
+void ScaleDisplay::clearField(uint8_t col, uint8_t row, uint8_t n) {
+   blankCells(col, row, n * magnify, true);
+   cursorCol = col;   // The library leaves the cursor here without sending anything more
+   cursorRow = row;
+}
+
+void ScaleDisplay::clearToEOL() {
+   blankCells(cursorCol, cursorRow, CELLS, true);
+}
+
+void ScaleDisplay::setContrast(uint8_t value) {
+   busTransfer(COMMAND_TRANSFER, 2);
+   contrast = value;
+   screenChanged = true;
+}
+
+uint8_t ScaleDisplay::fontRows() {
+   return magnify;
+}
+
+uint8_t ScaleDisplay::fieldWidth(uint8_t n) {
+   return n * CELL_WIDTH * magnify;
+}
+
+size_t ScaleDisplay::write(uint8_t c) {
+   if(c == '\r') {
+      return 1;
+   }
+   if(c == '\n') {
+      cursorCol = 0;
+      cursorRow += magnify;
+      return 1;
+   }
+   if(cursorRow + magnify > DISPLAY_ROWS || cursorCol + CELL_WIDTH * magnify > DISPLAY_WIDTH) {
+      return 1;   // Off the edge, the real display drops it too
+   }
+   uint8_t cell = cursorCol / CELL_WIDTH;
+   blankCells(cursorCol, cursorRow, magnify, false);
+   if(magnify == 2) {   // 2X goes a page at a time
+      for(uint8_t page = 0; page < 2; page++) {
+         busTransfer(COMMAND_TRANSFER, CURSOR_BYTES);
+         busTransfer(DATA_TRANSFER, 2 * CELL_WIDTH);
+      }
+   } else {
+      busTransfer(DATA_TRANSFER, CELL_WIDTH);
+   }
+   screen[cursorRow][cell] = c;
+   if(magnify == 2 && c != ' ') {   // A 2X blank is just blank cells, however the pixels got blank
+      screen[cursorRow][cell + 1] = COVERED_RIGHT;
+      screen[cursorRow + 1][cell] = COVERED_BELOW;
+      screen[cursorRow + 1][cell + 1] = COVERED_RIGHT;
+   }
+   cursorCol += CELL_WIDTH * magnify;
+   return 1;
+}
+
+#ifdef BIG_DIGITS
+// The dump shows a big digit as its character in the cell at its top left, with a '.' after
+// it if it has the point, and blanks over the rest of it.
+void ScaleDisplay::writeBig(uint8_t glyph, uint8_t page, uint8_t first, uint8_t n) {
+   busTransfer(DATA_TRANSFER, n);
+   screenChanged = true;
+   uint8_t left = cursorCol - first;
+   uint8_t top = cursorRow - page;
+   for(uint8_t r = top; r < top + BIG_DIGIT_PAGES && r < DISPLAY_ROWS; r++) {
+      for(uint8_t c = left / CELL_WIDTH; c < (left + BIG_DIGIT_WIDTH) / CELL_WIDTH && c < CELLS; c++) {   // Not the next slot's cell
+         screen[r][c] = ' ';
+      }
+   }
+   uint8_t cell = left / CELL_WIDTH;
+   screen[top][cell] = glyph & ~BIG_POINT;
+   if((glyph & BIG_POINT) && cell + 1 < CELLS) {
+      screen[top][cell + 1] = '.';
+   }
+   cursorCol += n;
+}
+#endif
+
+void simDisplayDump(FILE *out) {
+   if(contrast == OLED_CONTRAST) {
+      fprintf(out, "+---------------------+\n");
+   } else {
+      fprintf(out, "+---------------------+ contrast %u\n", contrast);
+   }
+   for(uint8_t r = 0; r < DISPLAY_ROWS; r++) {
+      char line[CELLS + 1];
+      uint8_t len = 0;
+      for(uint8_t c = 0; c < CELLS; c++) {
+         if(screen[r][c] == COVERED_RIGHT) {
+            continue;
+         }
+         line[len++] = screen[r][c] == COVERED_BELOW ? ' ' : screen[r][c];
+      }
+      line[len] = 0;
+      fprintf(out, "|%-21s|\n", line);
+   }
+   fprintf(out, "+---------------------+\n");
+}
+
+//************************************************************************************
+// Knob.  The scenario queues up turns and button events, the firmware reads them.
+//************************************************************************************
+static int16_t pendingTurns = 0;
+static KnobButton pendingButtons[8];
+static uint8_t buttonHead = 0;
+static uint8_t buttonTail = 0;
+
+void simKnobTurn(int16_t notches) {
+   pendingTurns += notches;
+}
+
+void simKnobButton(KnobButton button) {
+   uint8_t next = (buttonHead + 1) % 8;
+   if(next != buttonTail) {
+      pendingButtons[buttonHead] = button;
+      buttonHead = next;
+   }
+}
+
+void ScaleKnob::begin(uint8_t pinA, uint8_t pinB, uint8_t pinSw, uint8_t stepsPerNotch) {
+}
+
+void ScaleKnob::service() {
+}
+
+int16_t ScaleKnob::getValue() {
+   simAdvance(DEVICE_POLL_US);
+   int16_t turns = pendingTurns;
+   pendingTurns = 0;
+   return turns;
+}
+
+KnobButton ScaleKnob::getButton() {
+   simAdvance(DEVICE_POLL_US);
+   if(buttonHead == buttonTail) {
+      return KNOB_OPEN;
+   }
+   KnobButton button = pendingButtons[buttonTail];
+   buttonTail = (buttonTail + 1) % 8;
+   return button;
+}
+
+//************************************************************************************
+// Timer
+//************************************************************************************
+void ScaleTimer::begin(unsigned long periodUs, void (*isr)()) {
+   timerPeriodUs = periodUs;
+   nextTickUs = nowUs + periodUs;
+   timerIsr = isr;
+}
+
+//************************************************************************************
+// EEPROM.  1 KB like the ATmega328, erased to 0xFF.
+//************************************************************************************
+static uint8_t eeprom[1024];
+static bool eepromErased = false;
+
+static void eraseEeprom() {
+   if(!eepromErased) {
+      memset(eeprom, 0xFF, sizeof(eeprom));
+      eepromErased = true;
+   }
+}
+
+void ScaleStorage::read(int address, void *data, uint8_t len) {
+   eraseEeprom();
+   for(uint8_t i = 0; i < len; i++) {
+      ((uint8_t *)data)[i] = eeprom[(address + i) % sizeof(eeprom)];
+   }
+}
+
+void ScaleStorage::write(int address, const void *data, uint8_t len) {
+   eraseEeprom();
+   for(uint8_t i = 0; i < len; i++) {
+      eeprom[(address + i) % sizeof(eeprom)] = ((const uint8_t *)data)[i];
+   }
+}
@@ -0,0 +1,364 @@
+/*******************************************************************************************************
+main() for the [env:native] host build.
+
+Runs the scale firmware's setup() and loop() on the simulated clock and devices, driven by a
+scenario - a list of timed steps, one per line:
+
+   <ms> load <lb>        Put this much on the scale
+   <ms> ramp <lb> <ms>   Move the load steadily to this much over that long (a slow creep)
+   <ms> gap <ms>         Lose the load cell's conversions for that long
+   <ms> turn <notches>   Turn the knob (negative moves the menu cursor down)
+   <ms> click | double | held
+   <ms> serial <text>    Send text to the scale's serial port
+   <ms> screen           Print what's on the display
+   <ms> expect <lb>      Check the weight the scale shows (to the hundredth)
+   <ms> stable <from ms> Check the weight has been stable the whole time since then
+   <ms> slices           Check no display slice so far has gone over DISPLAY_SLICE_US
+   <ms> end              Stop
+
+Times are simulated ms since power on.  "#" starts a comment.  With no argument the built-in
+scenario below runs (power on, a load and a slow creep on it, another load, a re-zero through the
+menu, then round the memories, more than the display queue holds, within the display budget, and
+last a gap in the conversions under a settled load).  Otherwise the scenario is read from the file
+named on the command line.  Exits with the number of failed "expect", "stable" and "slices" steps,
+and prints how much faster than real time the run went.
+
+   pio run -e native && .pio/build/native/program [scenario.txt]
+
+Or, with --replay, play a raw trace captured from a real scale through the firmware instead (see
+Replay.cpp).
+*******************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "Arduino.h"
+#include "NativeSim.h"
+#include "WeightMath.h"
+#include "DisplayQueue.h"
+#include "Stability.h"
+
+void setup();
+void loop();
+extern weight_t pounds;   // What the weight screen shows, from main.cpp
+extern DisplayQueue displayQueue;
+extern StabilityDetector stability;
+
+const uint32_t CAL_VAL_EEPROM_ADDRESS = 0;
+const float SIM_CAL_VAL = 47672.54;   // Counts per pound stored in the simulated EEPROM and used by the simulated load cell
+
+static const char defaultScenario[] =
+   "0 load 0\n"
+   "6000 expect 0.00\n"
+   "6000 screen\n"
+   "7000 load 1.00\n"
+   "9000 expect 1.00\n"
+   "9000 screen\n"
+   "9000 ramp 1.60 30000\n"   // Creep up 0.01 lb every 500 ms, too slowly to unsettle the window
+   "24000 expect 1.30\n"      // The display follows it rather than holding 1.00
+   "41000 expect 1.60\n"
+   "42000 load 2.50\n"
+   "44000 expect 2.50\n"
+   "45000 click\n"             // Into the menu
+   "45300 turn -1\n"           // Down to Re-Zero
+   "45600 turn -1\n"
+   "45800 screen\n"
+   "46000 click\n"             // Re-zero with the 2.5 lb still on
+   "47000 expect 0.00\n"
+   "48000 load 0\n"
+   "50000 expect -2.50\n"
+   "50000 screen\n"
+   "50500 click\n"             // Into the menu, then the memories
+   "50800 click\n"
+   "51000 turn -1\n"           // All the way round them, a new window each step past the bottom
+   "51100 turn -1\n"
+   "51200 turn -1\n"
+   "51300 turn -1\n"
+   "51400 turn -1\n"
+   "51500 turn -1\n"
+   "51600 turn -1\n"
+   "51700 turn -1\n"
+   "51800 turn -1\n"
+   "51900 turn -1\n"
+   "52000 turn -1\n"
+   "52300 screen\n"
+   "52500 double\n"
+   "52800 double\n"
+   "53500 slices\n"
+   "54000 load 3.00\n"
+   "57000 gap 1500\n"          // Longer than the stability window, the same load after it
+   "60000 stable 56000\n"
+   "60000 expect 0.50\n"
+   "60000 end\n";
+
+struct Step {
+   uint32_t ms;
+   char command[8];
+   char arg[48];
+};
+
+static Step steps[256];
+static uint16_t numSteps = 0;
+
+// The load, and where a "ramp" is taking it
+static double loadNow = 0;
+static double rampFrom = 0;
+static double rampTo = 0;
+static uint32_t rampStartMs = 0;
+static uint32_t rampMs = 0;
+
+static uint32_t lastMovingMs = 0;   // When the weight was last seen not stable
+
+//************************************************************************************
+// Split the scenario text into steps
+//************************************************************************************
+static bool parseScenario(const char *text) {
+   char line[96];
+   uint16_t lineNumber = 0;
+   while(*text) {
+      size_t len = strcspn(text, "\n");
+      snprintf(line, sizeof(line), "%.*s", (int)len, text);
+      text += len + (text[len] ? 1 : 0);
+      lineNumber++;
+
+      char *hash = strchr(line, '#');
+      if(hash) {
+         *hash = 0;
+      }
+      Step step;
+      step.arg[0] = 0;
+      int fields = sscanf(line, "%u %7s %47[^\n]", &step.ms, step.command, step.arg);
+      if(fields <= 0) {
+         continue;   // Blank or comment
+      }
+      if(fields < 2 || numSteps >= sizeof(steps) / sizeof(steps[0])) {
+         fprintf(stderr, "scenario line %u: can't use \"%s\"\n", lineNumber, line);
+         return false;
+      }
+      steps[numSteps++] = step;
+   }
+   return true;
+}
+
+static bool loadScenarioFile(const char *path, char *buf, size_t size) {
+   FILE *f = fopen(path, "r");
+   if(!f) {
+      perror(path);
+      return false;
+   }
+   size_t len = fread(buf, 1, size - 1, f);
+   buf[len] = 0;
+   fclose(f);
+   return true;
+}
+
+//************************************************************************************
+// Carry out one step.  Returns false on "end".
+//************************************************************************************
+static bool runStep(const Step &step, uint16_t &failures) {
+   if(strcmp(step.command, "load") == 0) {
+      loadNow = atof(step.arg);
+      rampMs = 0;
+      simSetLoad(loadNow);
+   } else if(strcmp(step.command, "ramp") == 0) {
+      rampFrom = loadNow;
+      rampTo = loadNow;
+      rampMs = 0;
+      sscanf(step.arg, "%lf %u", &rampTo, &rampMs);
+      rampStartMs = step.ms;
+   } else if(strcmp(step.command, "turn") == 0) {
+      simKnobTurn(atoi(step.arg));
+   } else if(strcmp(step.command, "click") == 0) {
+      simKnobButton(KNOB_CLICKED);
+   } else if(strcmp(step.command, "double") == 0) {
+      simKnobButton(KNOB_DOUBLE_CLICKED);
+   } else if(strcmp(step.command, "held") == 0) {
+      simKnobButton(KNOB_HELD);
+      simKnobButton(KNOB_RELEASED);
+   } else if(strcmp(step.command, "serial") == 0) {
+      simSerialInput(step.arg);
+      simSerialInput("\n");
+   } else if(strcmp(step.command, "screen") == 0) {
+      fflush(stdout);
+      printf("screen at %u ms\n", step.ms);
+      simDisplayDump(stdout);
+   } else if(strcmp(step.command, "expect") == 0) {
+      int32_t want = lround(atof(step.arg) * 100);
+      int32_t shown = lround(weightToDecimal(pounds) * (100 / DECIMAL_ONE));
+      bool ok = shown - want <= 1 && want - shown <= 1;
+      printf("%s at %u ms: expected %s lbs, showing %ld.%02ld\n", ok ? "PASS" : "FAIL", step.ms, step.arg,
+             (long)shown / 100, labs((long)shown % 100));
+      if(!ok) {
+         failures++;
+      }
+   } else if(strcmp(step.command, "gap") == 0) {
+      simLoseConversions(atoi(step.arg));
+   } else if(strcmp(step.command, "stable") == 0) {
+      bool ok = lastMovingMs < (uint32_t)atoi(step.arg);
+      printf("%s at %u ms: stable since %s ms, last moving at %u ms\n", ok ? "PASS" : "FAIL", step.ms, step.arg,
+             lastMovingMs);
+      if(!ok) {
+         failures++;
+      }
+   } else if(strcmp(step.command, "slices") == 0) {
+      bool ok = displayQueue.worstSliceUs() <= DISPLAY_SLICE_US;
+      printf("%s at %u ms: worst display slice %u us, budget %u us\n", ok ? "PASS" : "FAIL", step.ms,
+             displayQueue.worstSliceUs(), DISPLAY_SLICE_US);
+      if(!ok) {
+         failures++;
+      }
+   } else if(strcmp(step.command, "end") == 0) {
+      return false;
+   } else {
+      printf("unknown step \"%s\" at %u ms\n", step.command, step.ms);
+      failures++;
+   }
+   return true;
+}
+
+//************************************************************************************
+// The EEPROM float decode, at the edges a real scale's EEPROM can hand it (blank,
+// corrupted, or left by another sketch).  Only failures are printed, and they count
+// towards the exit code like a failed "expect".
+//************************************************************************************
+static uint16_t checkFloatDecode() {
+   static const struct {
+      float value;
+      int32_t centi;
+   } checks[] = {
+      { 0.0f, 0 },
+      { 1.0f, 100 },
+      { -2.5f, -250 },
+      { 47672.54f, 4767254 },
+      { 21474836.0f, 2147483600 },    // The largest that fits
+      { 21474838.0f, 0x7FFFFFFF },    // Past it, clamped
+      { 33554432.0f, 0x7FFFFFFF },
+      { 1e8f, 0x7FFFFFFF },
+      { -1e8f, -0x7FFFFFFF },
+      { 1e30f, 0x7FFFFFFF },
+   };
+   uint16_t failed = 0;
+   for(size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+      uint32_t bits;
+      memcpy(&bits, &checks[i].value, sizeof(bits));
+      int32_t centi = centiFromFloatBits(bits);
+      if(centi != checks[i].centi) {
+         printf("FAIL float decode: %g gave %ld hundredths, expected %ld\n", checks[i].value, (long)centi,
+                (long)checks[i].centi);
+         failed++;
+      }
+   }
+   return failed;
+}
+
+//************************************************************************************
+// Counts to pounds to hundredths past the ends of Q16.16: full-scale counts on the
+// 1.00 cal factor calibration starts from, and weights too big for a 32-bit multiply
+// by 100.  Only failures are printed, like checkFloatDecode().
+//************************************************************************************
+static uint16_t checkSaturation() {
+   static const struct {
+      int32_t calCenti;
+      int32_t counts;
+      int32_t centi;
+   } checks[] = {
+      { 4767254, 47673, 100 },
+      { 4767254, -47673, -100 },
+      { 100, 32767, 3276700 },            // The most Q16.16 holds, to the pound
+      { 100, 8388607, 3276800 },          // Full scale on the starting cal factor, pinned
+      { 100, -8388608, -3276800 },
+      { 4767254, 8388607, 17596 },        // Full scale on a real one
+      { 100000, 8388607, 838861 },        // Past 327 lb
+      { 1, 8388607, 3276800 },
+   };
+   uint16_t failed = 0;
+   for(size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+      WeightScale scale;
+      setWeightScale(scale, checks[i].calCenti);
+      int32_t centi = q16ToCenti(countsToPounds(checks[i].counts, scale));
+      if(centi != checks[i].centi) {
+         printf("FAIL saturation: %ld counts at %ld gave %ld hundredths, expected %ld\n", (long)checks[i].counts,
+                (long)checks[i].calCenti, (long)centi, (long)checks[i].centi);
+         failed++;
+      }
+   }
+   return failed;
+}
+
+//************************************************************************************
+// The steps run off the simulated clock rather than between loop() passes, so they
+// can click through the firmware's blocking waits (store confirm, the value editors)
+// too.  The run ends from in here, wherever the firmware happens to be.
+//************************************************************************************
+static std::chrono::steady_clock::time_point wallStart;
+static uint16_t failures = 0;
+static uint16_t nextStep = 0;
+static uint32_t loops = 0;
+
+static void runDueSteps() {
+   if(!stability.isStable()) {
+      lastMovingMs = simTimeUs() / 1000;
+   }
+   if(rampMs) {
+      uint32_t elapsed = simTimeUs() / 1000 - rampStartMs;
+      loadNow = elapsed >= rampMs ? rampTo : rampFrom + (rampTo - rampFrom) * elapsed / rampMs;
+      simSetLoad(loadNow);
+      if(elapsed >= rampMs) {
+         rampMs = 0;
+      }
+   }
+
+   bool running = true;
+   while(running && nextStep < numSteps && simTimeUs() / 1000 >= steps[nextStep].ms) {
+      running = runStep(steps[nextStep++], failures);
+   }
+   if(running && nextStep < numSteps) {
+      return;
+   }
+
+   double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+   double simMs = simTimeUs() / 1000.0;
+   printf("%.0f ms of scale time, %u loop passes, in %.1f ms (%.0fx real time), %lu display bus bytes.  %u failed.\n",
+          simMs, loops, wallMs, wallMs > 0 ? simMs / wallMs : 0.0, (unsigned long)simDisplayBusBytes(), failures);
+   fflush(stdout);
+   exit(failures);
+}
+
+int main(int argc, char **argv) {
+   static char fileText[16384];
+   const char *text = defaultScenario;
+   bool replay = argc > 2 && strcmp(argv[1], "--replay") == 0;
+   if(argc > 1 && !replay) {
+      if(!loadScenarioFile(argv[1], fileText, sizeof(fileText))) {
+         return 255;
+      }
+      text = fileText;
+   }
+   if(!parseScenario(text)) {
+      return 255;
+   }
+
+   // A scale that has been calibrated, with empty memories, as older firmware left its EEPROM
+   // (the fixed addresses ValueLog reads until a value is first written to the log)
+   uint32_t calBits;
+   memcpy(&calBits, &SIM_CAL_VAL, sizeof(calBits));
+   ScaleStorage::write(CAL_VAL_EEPROM_ADDRESS, &calBits, sizeof(calBits));
+   for(uint8_t i = 1; i <= 8; i++) {
+      uint32_t zero = 0;
+      ScaleStorage::write(i * sizeof(float), &zero, sizeof(zero));
+   }
+   simSetCountsPerPound(SIM_CAL_VAL);
+   if(replay) {
+      return runReplay(argv[2]);
+   }
+
+   failures += checkFloatDecode();
+   failures += checkSaturation();
+   wallStart = std::chrono::steady_clock::now();
+   simSetClockHook(runDueSteps);
+   setup();
+   for(;;) {
+      loop();
+      loops++;
+   }
+}
@@ -0,0 +1,48 @@
+/*******************************************************************************************************
+Simulated scale hardware for the [env:native] host build.
+
+The firmware only sees the interfaces in Hal.h and Hx711Isr.h.  These calls are the other side of
+them - what the test scenario (NativeMain.cpp) uses to drive the simulated devices and look at the
+results.
+*******************************************************************************************************/
+#ifndef NATIVE_SIM_H
+#define NATIVE_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "Hal.h"
+
+// Clock
+void simAdvance(uint32_t us);              // Move time on, running any HX711 conversions and timer ticks that come due
+uint64_t simTimeUs();
+void simSetClockHook(void (*hook)());      // Called every time the clock moves on, even in the middle of a blocking wait
+
+// Load cell
+void simSetLoad(double pounds);            // What's sitting on the scale from now on
+void simSetCountsPerPound(double counts);  // Load cell sensitivity
+void simSetNoise(int32_t counts);          // Peak conversion noise, uniform +/-counts
+void simLoseConversions(uint32_t ms);      // None reach the firmware for this long from now, as if the HX711 stalled
+
+// Load cell, playing back a captured raw trace instead (see Replay.cpp)
+struct SimTraceSample {
+   uint32_t ms;                            // Timestamp from the capture
+   int32_t raw;
+};
+void simPlayTrace(const SimTraceSample *samples, uint32_t count, uint32_t startMs);   // Trace starts at startMs simulated time
+
+// Knob
+void simKnobTurn(int16_t notches);         // Positive turns the same way as ScaleKnob::getValue()
+void simKnobButton(KnobButton button);
+
+// Serial input (what a host would send the scale)
+void simSerialInput(const char *text);
+
+// Display
+void simDisplayDump(FILE *out);            // The screen as text, 2X characters shown once
+bool simDisplayChanged();                  // Anything sent to the display since the last call
+uint32_t simDisplayBusBytes();             // Bytes sent to the display so far, as SSD1306Ascii would send them
+
+// Replay a raw trace through the firmware and report on it (Replay.cpp)
+int runReplay(const char *path);
+
+#endif
@@ -0,0 +1,297 @@
+/*******************************************************************************************************
+Replay a raw HX711 trace through the firmware and measure how the displayed weight behaves.
+
+The trace is what the scale prints with RAW_TRACE on after a "t" on the serial port, saved to a file
+(other lines are ignored, so a whole serial log will do):
+
+   R,<ms>,<raw>     One conversion, as it came off the HX711
+   C,<cal>          Calibration value in use (counts per pound)
+   Z,<tare>         Tare offset in use (counts)
+
+The scale boots on the simulated clock with the first conversion on the load cell, then the trace
+is fed in at its own timestamps, and the calibration and tare follow the C and Z lines.  The weight
+the scale would show is sampled every ms.
+
+The raw data is split into events wherever the load steps by more than REPLAY_STEP_LBS.  That only
+looks at the raw counts, so it doesn't depend on the filter being measured.  For each event we
+report:
+
+   settle      ms from the step until the display stays within REPLAY_SETTLE_CENTI of the final
+               weight (the mean of the raw data at the end of the event)
+   overshoot   furthest the display went past the final weight
+   noise       standard deviation of the displayed weight once settled, and of the raw data
+   updates     times anything was sent to the display (and the bus bytes they took, in the totals)
+
+   pio run -e native && .pio/build/native/program --replay trace.txt
+*******************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "Arduino.h"
+#include "NativeSim.h"
+#include "WeightMath.h"
+#include "IsrLoadCell.h"
+
+void setup();
+void loop();
+extern weight_t pounds;       // What the weight screen shows, from main.cpp
+extern IsrLoadCell loadCell;
+
+const uint32_t REPLAY_BOOT_MS = 6000;        // Scale is up and zeroed by then, the trace starts here
+const uint32_t REPLAY_TAIL_MS = 2000;        // Keep going after the trace so the last event can settle
+const double REPLAY_STEP_LBS = 0.05;         // A load change this big starts a new event
+const uint32_t REPLAY_MIN_EVENT_MS = 1000;   // Placing something takes a while, don't split it up
+const int32_t REPLAY_SETTLE_CENTI = 1;       // Settled when the display is this close to the final weight
+const uint32_t REPLAY_NOISE_MS = 1000;       // Noise is measured over the end of each event
+
+struct TraceSetting {
+   uint32_t ms;
+   char kind;        // 'C' or 'Z'
+   double value;
+};
+
+static std::vector<SimTraceSample> samples;
+static std::vector<TraceSetting> settings;
+
+//************************************************************************************
+// Read the trace.  A setting takes effect at the next sample's time.
+//************************************************************************************
+static bool loadTrace(const char *path) {
+   FILE *f = fopen(path, "r");
+   if(!f) {
+      perror(path);
+      return false;
+   }
+   char line[128];
+   while(fgets(line, sizeof(line), f)) {
+      // Serial logs from the native build have the time in front
+      char *p = line;
+      if(*p == '[') {
+         p = strchr(p, ']');
+         p = p ? p + 1 : line;
+         while(*p == ' ') {
+            p++;
+         }
+      }
+      unsigned long ms;
+      long raw;
+      double value;
+      if(sscanf(p, "R,%lu,%ld", &ms, &raw) == 2) {
+         SimTraceSample s = { (uint32_t)ms, (int32_t)raw };
+         samples.push_back(s);
+      } else if((p[0] == 'C' || p[0] == 'Z') && sscanf(p + 1, ",%lf", &value) == 1) {
+         TraceSetting s = { samples.empty() ? 0 : samples.back().ms + 1, p[0], value };
+         settings.push_back(s);
+      }
+   }
+   fclose(f);
+   if(samples.empty()) {
+      fprintf(stderr, "%s: no R,<ms>,<raw> lines\n", path);
+      return false;
+   }
+   return true;
+}
+
+static void applySetting(const TraceSetting &s) {
+   if(s.kind == 'C') {
+#ifdef FLOAT_WEIGHT_MATH
+      loadCell.setCalFactor(s.value);
+#else
+      loadCell.setCalFactor(lround(s.value * DECIMAL_ONE));
+#endif
+   } else {
+      loadCell.setTareOffset(lround(s.value));
+   }
+}
+
+static int32_t shownCenti() {
+   return lround(weightToDecimal(pounds) * (100 / DECIMAL_ONE));
+}
+
+static void printCenti(int32_t centi) {
+   printf("%s%ld.%02ld", centi < 0 ? "-" : "", labs((long)centi) / 100, labs((long)centi) % 100);
+}
+
+//************************************************************************************
+// Replay the trace and report on each event in it
+//************************************************************************************
+int runReplay(const char *path) {
+   if(!loadTrace(path)) {
+      return 255;
+   }
+   uint32_t firstMs = samples[0].ms;
+   uint32_t traceMs = samples.back().ms - firstMs + 1;
+
+   simPlayTrace(&samples[0], samples.size(), REPLAY_BOOT_MS);
+   setup();
+
+   // Settings from before the first sample are the ones the scale was using
+   size_t nextSetting = 0;
+   double cal = loadCell.getCalFactor() / (double)DECIMAL_ONE;
+   double tare = loadCell.getTareOffset();
+   while(nextSetting < settings.size() && settings[nextSetting].ms <= firstMs) {
+      applySetting(settings[nextSetting++]);
+   }
+
+   // Run it, noting the shown weight each ms and when the display changes
+   std::vector<int32_t> shown(traceMs + REPLAY_TAIL_MS);
+   std::vector<uint32_t> updates;
+   uint32_t recordedMs = 0;
+   uint32_t busBytes = 0;
+   simDisplayChanged();
+   while(recordedMs < shown.size()) {
+      uint64_t now = simTimeUs() / 1000;
+      uint32_t traceNow = now >= REPLAY_BOOT_MS ? now - REPLAY_BOOT_MS : 0;
+      while(nextSetting < settings.size() && settings[nextSetting].ms - firstMs <= traceNow) {
+         applySetting(settings[nextSetting++]);
+      }
+      uint32_t bytesBefore = simDisplayBusBytes();
+      loop();
+      if(simDisplayChanged() && now >= REPLAY_BOOT_MS) {
+         updates.push_back(traceNow);
+         busBytes += simDisplayBusBytes() - bytesBefore;
+      }
+      now = simTimeUs() / 1000;
+      while(now >= REPLAY_BOOT_MS && recordedMs <= now - REPLAY_BOOT_MS && recordedMs < shown.size()) {
+         shown[recordedMs++] = shownCenti();
+      }
+   }
+
+   // What each sample should read, from the raw counts and the settings of the time
+   std::vector<double> reference(samples.size());
+   for(size_t i = 0, s = 0; i < samples.size(); i++) {
+      for(; s < settings.size() && settings[s].ms <= samples[i].ms; s++) {
+         if(settings[s].kind == 'C') {
+            cal = settings[s].value;
+         } else {
+            tare = settings[s].value;
+         }
+      }
+      reference[i] = (samples[i].raw - tare) / cal;
+   }
+
+   // Split into events: a step in the raw load, or a change of tare or calibration
+   std::vector<size_t> starts(1, 0);
+   double sum = reference[0];
+   uint32_t count = 1;
+   for(size_t i = 1, s = 0; i < samples.size(); i++) {
+      bool setting = false;
+      for(; s < settings.size() && settings[s].ms <= samples[i].ms; s++) {
+         setting = settings[s].ms > firstMs;
+      }
+      uint32_t sinceStart = samples[i].ms - samples[starts.back()].ms;
+      if(sinceStart < REPLAY_MIN_EVENT_MS && !setting) {
+         continue;
+      }
+      if(setting || (count && fabs(reference[i] - sum / count) > REPLAY_STEP_LBS)) {
+         starts.push_back(i);
+         sum = 0;
+         count = 0;
+      }
+      sum += reference[i];
+      count++;
+   }
+
+   printf("\n%s: %u samples over %lu ms (%.1f/s), %u events\n", path, (unsigned)samples.size(),
+          (unsigned long)traceMs, samples.size() * 1000.0 / traceMs, (unsigned)starts.size());
+   printf("event  start_ms  final_lbs  settle_ms  overshoot_lbs  noise_lbs  raw_noise_lbs  updates\n");
+
+   uint32_t settledEvents = 0;
+   uint32_t totalSettle = 0;
+   uint32_t worstSettle = 0;
+   for(size_t e = 0; e < starts.size(); e++) {
+      size_t first = starts[e];
+      size_t end = e + 1 < starts.size() ? starts[e + 1] : samples.size();
+      uint32_t startMs = samples[first].ms - firstMs;
+      uint32_t endMs = e + 1 < starts.size() ? samples[end].ms - firstMs : shown.size();
+      uint32_t noiseToMs = endMs < traceMs ? endMs : traceMs;   // While there's raw data to compare with
+      uint32_t noiseFromMs = noiseToMs - startMs > 2 * REPLAY_NOISE_MS ? noiseToMs - REPLAY_NOISE_MS : (startMs + noiseToMs) / 2;
+
+      // Final weight and raw noise over the end of the event
+      double rawSum = 0, rawSquares = 0;
+      uint32_t rawCount = 0;
+      for(size_t i = first; i < end; i++) {
+         if(samples[i].ms - firstMs >= noiseFromMs) {
+            rawSum += reference[i];
+            rawSquares += reference[i] * reference[i];
+            rawCount++;
+         }
+      }
+      if(!rawCount) {
+         rawSum = reference[end - 1];
+         rawSquares = rawSum * rawSum;
+         rawCount = 1;
+      }
+      double final = rawSum / rawCount;
+      double rawNoise = sqrt(fmax(0, rawSquares / rawCount - final * final));
+      int32_t finalCenti = lround(final * 100);
+
+      // Settle time and overshoot, in the direction the display had to move
+      int32_t before = startMs ? shown[startMs - 1] : shown[0];
+      int direction = finalCenti > before ? 1 : finalCenti < before ? -1 : 0;
+      int32_t overshoot = 0;
+      uint32_t lastOut = startMs;
+      bool everOut = false;
+      for(uint32_t ms = startMs; ms < endMs; ms++) {
+         int32_t error = shown[ms] - finalCenti;
+         if(error > REPLAY_SETTLE_CENTI || -error > REPLAY_SETTLE_CENTI) {
+            lastOut = ms;
+            everOut = true;
+         }
+         if(direction && error * direction > overshoot) {
+            overshoot = error * direction;
+         }
+      }
+      bool settled = !everOut || lastOut + 1 < endMs;
+      uint32_t settle = everOut ? lastOut + 1 - startMs : 0;
+
+      // Displayed noise over the same stretch as the raw noise.  An event too short to
+      // have any (one that starts on the trace's last ms) has none to report.
+      bool haveNoise = noiseToMs > noiseFromMs;
+      double shownNoise = 0;
+      if(haveNoise) {
+         double shownSum = 0, shownSquares = 0;
+         for(uint32_t ms = noiseFromMs; ms < noiseToMs; ms++) {
+            shownSum += shown[ms] / 100.0;
+            shownSquares += (shown[ms] / 100.0) * (shown[ms] / 100.0);
+         }
+         double shownMean = shownSum / (noiseToMs - noiseFromMs);
+         shownNoise = sqrt(fmax(0, shownSquares / (noiseToMs - noiseFromMs) - shownMean * shownMean));
+      }
+
+      uint32_t eventUpdates = 0;
+      for(size_t u = 0; u < updates.size(); u++) {
+         if(updates[u] >= startMs && updates[u] < endMs) {
+            eventUpdates++;
+         }
+      }
+
+      printf("%5u  %8lu  %9.2f  ", (unsigned)e + 1, (unsigned long)startMs, final);
+      if(settled) {
+         printf("%9lu  ", (unsigned long)settle);
+         settledEvents++;
+         totalSettle += settle;
+         if(settle > worstSettle) {
+            worstSettle = settle;
+         }
+      } else {
+         printf("%9s  ", "never");
+      }
+      printf("%13.2f  ", overshoot / 100.0);
+      if(haveNoise) {
+         printf("%9.4f  ", shownNoise);
+      } else {
+         printf("%9s  ", "n/a");
+      }
+      printf("%13.4f  %7lu\n", rawNoise, (unsigned long)eventUpdates);
+   }
+
+   printf("settled %u of %u events, mean %lu ms, worst %lu ms.  %u display updates (%.1f/s), %lu bus bytes (%lu per update).  Last shown ",
+          settledEvents, (unsigned)starts.size(), settledEvents ? (unsigned long)(totalSettle / settledEvents) : 0UL,
+          (unsigned long)worstSettle, (unsigned)updates.size(), updates.size() * 1000.0 / shown.size(),
+          (unsigned long)busBytes, updates.empty() ? 0UL : (unsigned long)(busBytes / updates.size()));
+   printCenti(shown.back());
+   printf(" lbs.\n");
+   return 0;
+}
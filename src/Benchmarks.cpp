@@ -0,0 +1,238 @@
+/*******************************************************************************************************
+On-target benchmarks.  See Benchmarks.h.
+*******************************************************************************************************/
+#include <Arduino.h>
+#include "ScaleConfig.h"
+#include "Benchmarks.h"
+#include "WeightMath.h"
+#include "Filters.h"
+#include "NumberFormat.h"
+
+#ifdef RUN_BENCHMARKS
+
+const uint16_t BENCH_ITERATIONS = 1000;
+
+// Volatile so the compiler can't fold the math away or hoist it out of the loops
+static volatile int32_t benchRaw = 1234567;
+static volatile int32_t benchTare = 345678;
+static volatile float benchSinkF;
+static volatile int32_t benchSinkI;
+static volatile bool benchSinkB;
+
+//************************************************************************************
+// Print the cycles per iteration for a timed loop, less the empty loop overhead
+//************************************************************************************
+static uint32_t reportCycles(const __FlashStringHelper *label, unsigned long elapsed, unsigned long overhead,
+                             const __FlashStringHelper *per = F(" cycles/sample")) {
+   uint32_t cycles = (elapsed > overhead ? elapsed - overhead : 0) * (F_CPU / 1000000UL) / BENCH_ITERATIONS;
+   Serial.print(label);
+   Serial.print(cycles);
+   Serial.println(per);
+   return cycles;
+}
+
+//************************************************************************************
+// Per-sample cost of the weight math, raw counts in, display units out.
+// Float path is the original: (raw - tare) / calVal, * lb->kg, abs() change test.
+// Fixed path is the same plus the conversion to display-ready hundredths (the float
+// path leaves that to Print's float formatting, which costs a good deal more again).
+//************************************************************************************
+void benchmarkWeightMath() {
+   float calFloat = 47672.54;
+   float lastFloat = 0.0;
+   WeightScale scale;
+   setWeightScale(scale, 4767254);
+   q16_t lastFixed = 0;
+   unsigned long start;
+
+   start = micros();
+   for(uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      benchSinkI = benchRaw + i - benchTare;
+   }
+   unsigned long overhead = micros() - start;
+
+   start = micros();
+   for(uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      float lbs = (float)(benchRaw + i - benchTare) / calFloat;
+      benchSinkF = lbs * 0.45359237;
+      benchSinkB = abs(lbs - lastFloat) > .001;
+      lastFloat = lbs;
+   }
+   unsigned long floatTime = micros() - start;
+
+   start = micros();
+   for(uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      q16_t lbs = countsToPounds(benchRaw + i - benchTare, scale);
+      q16_t kgs = poundsToKilogramsQ16(lbs);
+      benchSinkB = abs(lbs - lastFixed) > 66;
+      benchSinkI = q16ToCenti(lbs);
+      benchSinkI = q16ToCenti(kgs);
+      lastFixed = lbs;
+   }
+   unsigned long fixedTime = micros() - start;
+
+   Serial.println(F("Weight math, raw sample to display units:"));
+   uint32_t floatCycles = reportCycles(F("  soft-float:  "), floatTime, overhead);
+   uint32_t fixedCycles = reportCycles(F("  fixed-point: "), fixedTime, overhead);
+   Serial.print(F("  saved:       "));
+   Serial.print(floatCycles > fixedCycles ? floatCycles - fixedCycles : 0);
+   Serial.println(F(" cycles/sample"));
+}
+
+
+//************************************************************************************
+// Feed the same synthetic load event through the original fixed 16-sample moving
+// average and through the filter chain.  The trace is 1 lb (47672 counts, a typical
+// 5kg cal) placed on an empty scale, with +/-30 counts of HX711-like noise and one
+// 20000 count spike while the load sits still.
+// Settled means within half a display digit (0.005 lb) and staying there.
+//************************************************************************************
+const uint8_t SETTLE_PRE_SAMPLES = 40;    // Empty scale before the step
+const uint8_t SETTLE_POST_SAMPLES = 60;   // Load on the scale after the step
+const int32_t SETTLE_STEP = 47672;
+const int32_t SETTLE_TOLERANCE = 238;
+const uint8_t SETTLE_SPIKE_AT = 40;       // Samples after the step
+const uint16_t SETTLE_MS_PER_SAMPLE = 100;   // 10 SPS
+
+static void reportSettle(const __FlashStringHelper *label, int16_t settleSamples, int32_t jitter) {
+   Serial.print(label);
+   if(settleSamples < 0) {
+      Serial.print(F("never"));
+   } else {
+      Serial.print(settleSamples);
+      Serial.print(F(" samples ("));
+      Serial.print((uint32_t)settleSamples * SETTLE_MS_PER_SAMPLE);
+      Serial.print(F(" ms at 10 SPS)"));
+   }
+   Serial.print(F(", still-load jitter "));
+   Serial.print(jitter);
+   Serial.println(F(" counts p-p"));
+}
+
+void benchmarkSettleTime() {
+   FilterChain chain;
+   chain.setStepThreshold(SETTLE_STEP * FILTER_STEP_CENTI / 100 > FILTER_STEP_MIN_COUNTS ?
+                          SETTLE_STEP * FILTER_STEP_CENTI / 100 : FILTER_STEP_MIN_COUNTS);
+   int32_t window[16] = {0};
+   int32_t windowSum = 0;
+   uint8_t windowIndex = 0;
+   uint8_t windowCount = 0;
+   int16_t settleOld = -1;
+   int16_t settleNew = -1;
+   int32_t minOld = 0x7FFFFFFF, maxOld = -0x7FFFFFFF;
+   int32_t minNew = 0x7FFFFFFF, maxNew = -0x7FFFFFFF;
+   uint32_t seed = 1;
+
+   for(uint8_t i = 0; i < SETTLE_PRE_SAMPLES + SETTLE_POST_SAMPLES; i++) {
+      seed = seed * 1103515245UL + 12345;
+      int32_t raw = (int32_t)((seed >> 16) % 61) - 30;
+      if(i >= SETTLE_PRE_SAMPLES) {
+         raw += SETTLE_STEP;
+      }
+      if(i == SETTLE_PRE_SAMPLES + SETTLE_SPIKE_AT) {
+         raw += 20000;
+      }
+
+      windowSum -= window[windowIndex];
+      window[windowIndex] = raw;
+      windowSum += raw;
+      windowIndex = (windowIndex + 1) % 16;
+      if(windowCount < 16) {
+         windowCount++;
+      }
+      int32_t oldOut = windowSum / windowCount;
+      int32_t newOut = chain.process(raw);
+
+      if(i < SETTLE_PRE_SAMPLES) {
+         continue;
+      }
+      int16_t sinceStep = i - SETTLE_PRE_SAMPLES;
+      if(abs(oldOut - SETTLE_STEP) <= SETTLE_TOLERANCE) {
+         if(settleOld < 0) {
+            settleOld = sinceStep;
+         }
+      } else {
+         settleOld = -1;
+      }
+      if(abs(newOut - SETTLE_STEP) <= SETTLE_TOLERANCE) {
+         if(settleNew < 0) {
+            settleNew = sinceStep;
+         }
+      } else {
+         settleNew = -1;
+      }
+      if(sinceStep >= 20) {   // Both have settled by now, measure how much the reading wanders
+         minOld = min(minOld, oldOut);
+         maxOld = max(maxOld, oldOut);
+         minNew = min(minNew, newOut);
+         maxNew = max(maxNew, newOut);
+      }
+   }
+
+   Serial.println(F("Time to stable reading after a 1 lb step:"));
+   reportSettle(F("  16-sample average: "), settleOld, maxOld - minOld);
+   reportSettle(F("  filter chain:      "), settleNew, maxNew - minNew);
+}
+
+//************************************************************************************
+// Cost of turning one weight into text.  Print's float path (what the float build
+// used), Print's integer path (the fixed-point build's printDecimal() before
+// NumberFormat.h), and printFixed().  The text goes to a Print that drops it, so this
+// is the formatting and nothing else.  -12.34 is the widest the weight screen shows.
+//************************************************************************************
+class NullPrint : public Print {
+public:
+   size_t write(uint8_t c) { return 1; }
+   using Print::write;
+};
+
+static volatile float benchWeightF = -12.34;
+static volatile int32_t benchWeightCenti = -1234;
+
+void benchmarkNumberFormat() {
+   NullPrint sink;
+   unsigned long start;
+
+   start = micros();
+   for(uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      benchSinkI = benchWeightCenti;
+   }
+   unsigned long overhead = micros() - start;
+
+   start = micros();
+   for(uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      sink.print(benchWeightF, 2);
+   }
+   unsigned long floatTime = micros() - start;
+
+   start = micros();
+   for(uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      int32_t val = benchWeightCenti;
+      if(val < 0) {
+         sink.print('-');
+         val = -val;
+      }
+      sink.print(val / 100);
+      sink.print('.');
+      uint8_t hundredths = val % 100;
+      if(hundredths < 10) {
+         sink.print('0');
+      }
+      sink.print((int)hundredths);
+   }
+   unsigned long printTime = micros() - start;
+
+   start = micros();
+   for(uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      printFixed(sink, benchWeightCenti, 2, 6);
+   }
+   unsigned long fixedTime = micros() - start;
+
+   Serial.println(F("Number formatting, one weight (-12.34):"));
+   reportCycles(F("  Print float:      "), floatTime, overhead, F(" cycles/number"));
+   reportCycles(F("  Print integer:    "), printTime, overhead, F(" cycles/number"));
+   reportCycles(F("  printFixed():     "), fixedTime, overhead, F(" cycles/number"));
+   Serial.println(F("  (flash for each is in the build output, tools/flash_report.py)"));
+}
+
+#endif
@@ -0,0 +1,171 @@
+/*******************************************************************************************************
+Large digits for the weight readout.  See BigDigits.h.
+
+Seven-segment digits with bevelled segment ends and a one-pixel gap where segments meet.  Each glyph
+is stored a page at a time, one byte per pixel column with the top pixel in bit 0 - the way the
+SH1106 takes them - so drawing one is a copy from flash.
+*******************************************************************************************************/
+#include "BigDigits.h"
+
+#ifdef BIG_DIGITS
+
+const uint8_t BIG_GLYPHS = 11;          // 0-9, then '-'
+
+#if BIG_DIGITS == 3
+// 11 x 23 pixels, 3-pixel strokes, three pages
+static const uint8_t glyphs[BIG_GLYPHS][BIG_DIGIT_PAGES][BIG_INK_WIDTH] PROGMEM = {
+   {  // 0
+      { 0xF8, 0xFC, 0xFA, 0x07, 0x07, 0x07, 0x07, 0x07, 0xFA, 0xFC, 0xF8 },
+      { 0xE3, 0xF7, 0xE3, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE3, 0xF7, 0xE3 },
+      { 0x0F, 0x1F, 0x2F, 0x70, 0x70, 0x70, 0x70, 0x70, 0x2F, 0x1F, 0x0F }
+   },
+   {  // 1
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF8, 0xFC, 0xF8 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE3, 0xF7, 0xE3 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x1F, 0x0F }
+   },
+   {  // 2
+      { 0x00, 0x00, 0x02, 0x07, 0x07, 0x07, 0x07, 0x07, 0xFA, 0xFC, 0xF8 },
+      { 0xE0, 0xF0, 0xE8, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x0B, 0x07, 0x03 },
+      { 0x0F, 0x1F, 0x2F, 0x70, 0x70, 0x70, 0x70, 0x70, 0x20, 0x00, 0x00 }
+   },
+   {  // 3
+      { 0x00, 0x00, 0x02, 0x07, 0x07, 0x07, 0x07, 0x07, 0xFA, 0xFC, 0xF8 },
+      { 0x00, 0x00, 0x08, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0xEB, 0xF7, 0xE3 },
+      { 0x00, 0x00, 0x20, 0x70, 0x70, 0x70, 0x70, 0x70, 0x2F, 0x1F, 0x0F }
+   },
+   {  // 4
+      { 0xF8, 0xFC, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF8, 0xFC, 0xF8 },
+      { 0x03, 0x07, 0x0B, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0xEB, 0xF7, 0xE3 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x1F, 0x0F }
+   },
+   {  // 5
+      { 0xF8, 0xFC, 0xFA, 0x07, 0x07, 0x07, 0x07, 0x07, 0x02, 0x00, 0x00 },
+      { 0x03, 0x07, 0x0B, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0xE8, 0xF0, 0xE0 },
+      { 0x00, 0x00, 0x20, 0x70, 0x70, 0x70, 0x70, 0x70, 0x2F, 0x1F, 0x0F }
+   },
+   {  // 6
+      { 0xF8, 0xFC, 0xFA, 0x07, 0x07, 0x07, 0x07, 0x07, 0x02, 0x00, 0x00 },
+      { 0xE3, 0xF7, 0xEB, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0xE8, 0xF0, 0xE0 },
+      { 0x0F, 0x1F, 0x2F, 0x70, 0x70, 0x70, 0x70, 0x70, 0x2F, 0x1F, 0x0F }
+   },
+   {  // 7
+      { 0x00, 0x00, 0x02, 0x07, 0x07, 0x07, 0x07, 0x07, 0xFA, 0xFC, 0xF8 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE3, 0xF7, 0xE3 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x1F, 0x0F }
+   },
+   {  // 8
+      { 0xF8, 0xFC, 0xFA, 0x07, 0x07, 0x07, 0x07, 0x07, 0xFA, 0xFC, 0xF8 },
+      { 0xE3, 0xF7, 0xEB, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0xEB, 0xF7, 0xE3 },
+      { 0x0F, 0x1F, 0x2F, 0x70, 0x70, 0x70, 0x70, 0x70, 0x2F, 0x1F, 0x0F }
+   },
+   {  // 9
+      { 0xF8, 0xFC, 0xFA, 0x07, 0x07, 0x07, 0x07, 0x07, 0xFA, 0xFC, 0xF8 },
+      { 0x03, 0x07, 0x0B, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0xEB, 0xF7, 0xE3 },
+      { 0x00, 0x00, 0x20, 0x70, 0x70, 0x70, 0x70, 0x70, 0x2F, 0x1F, 0x0F }
+   },
+   {  // -
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+      { 0x00, 0x00, 0x08, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x08, 0x00, 0x00 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+   }
+};
+static const uint8_t point[BIG_DIGIT_PAGES] PROGMEM = { 0x00, 0x00, 0x70 };   // 3 x 3, level with the bottom stroke
+#else
+// 15 x 30 pixels, 4-pixel strokes, four pages
+static const uint8_t glyphs[BIG_GLYPHS][BIG_DIGIT_PAGES][BIG_INK_WIDTH] PROGMEM = {
+   {  // 0
+      { 0xE0, 0xF0, 0xF0, 0xEC, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0xEC, 0xF0, 0xF0, 0xE0 },
+      { 0x3F, 0x7F, 0x7F, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x7F, 0x7F, 0x3F },
+      { 0xFC, 0xFE, 0xFE, 0xFC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFC, 0xFE, 0xFE, 0xFC },
+      { 0x07, 0x0F, 0x0F, 0x37, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x37, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 1
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0xF0, 0xF0, 0xE0 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x7F, 0x7F, 0x3F },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFC, 0xFE, 0xFE, 0xFC },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 2
+      { 0x00, 0x00, 0x00, 0x0C, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0xEC, 0xF0, 0xF0, 0xE0 },
+      { 0x00, 0x00, 0x00, 0x80, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F, 0x7F, 0x3F },
+      { 0xFC, 0xFE, 0xFE, 0xFD, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x01, 0x00, 0x00, 0x00 },
+      { 0x07, 0x0F, 0x0F, 0x37, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x30, 0x00, 0x00, 0x00 }
+   },
+   {  // 3
+      { 0x00, 0x00, 0x00, 0x0C, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0xEC, 0xF0, 0xF0, 0xE0 },
+      { 0x00, 0x00, 0x00, 0x80, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F, 0x7F, 0x3F },
+      { 0x00, 0x00, 0x00, 0x01, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFD, 0xFE, 0xFE, 0xFC },
+      { 0x00, 0x00, 0x00, 0x30, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x37, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 4
+      { 0xE0, 0xF0, 0xF0, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0xF0, 0xF0, 0xE0 },
+      { 0x3F, 0x7F, 0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F, 0x7F, 0x3F },
+      { 0x00, 0x00, 0x00, 0x01, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFD, 0xFE, 0xFE, 0xFC },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 5
+      { 0xE0, 0xF0, 0xF0, 0xEC, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x0C, 0x00, 0x00, 0x00 },
+      { 0x3F, 0x7F, 0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x80, 0x00, 0x00, 0x00 },
+      { 0x00, 0x00, 0x00, 0x01, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFD, 0xFE, 0xFE, 0xFC },
+      { 0x00, 0x00, 0x00, 0x30, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x37, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 6
+      { 0xE0, 0xF0, 0xF0, 0xEC, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x0C, 0x00, 0x00, 0x00 },
+      { 0x3F, 0x7F, 0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x80, 0x00, 0x00, 0x00 },
+      { 0xFC, 0xFE, 0xFE, 0xFD, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFD, 0xFE, 0xFE, 0xFC },
+      { 0x07, 0x0F, 0x0F, 0x37, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x37, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 7
+      { 0x00, 0x00, 0x00, 0x0C, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0xEC, 0xF0, 0xF0, 0xE0 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3F, 0x7F, 0x7F, 0x3F },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFC, 0xFE, 0xFE, 0xFC },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 8
+      { 0xE0, 0xF0, 0xF0, 0xEC, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0xEC, 0xF0, 0xF0, 0xE0 },
+      { 0x3F, 0x7F, 0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F, 0x7F, 0x3F },
+      { 0xFC, 0xFE, 0xFE, 0xFD, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFD, 0xFE, 0xFE, 0xFC },
+      { 0x07, 0x0F, 0x0F, 0x37, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x37, 0x0F, 0x0F, 0x07 }
+   },
+   {  // 9
+      { 0xE0, 0xF0, 0xF0, 0xEC, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0xEC, 0xF0, 0xF0, 0xE0 },
+      { 0x3F, 0x7F, 0x7F, 0xBF, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xBF, 0x7F, 0x7F, 0x3F },
+      { 0x00, 0x00, 0x00, 0x01, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0xFD, 0xFE, 0xFE, 0xFC },
+      { 0x00, 0x00, 0x00, 0x30, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x78, 0x37, 0x0F, 0x0F, 0x07 }
+   },
+   {  // -
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+      { 0x00, 0x00, 0x00, 0x80, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0x80, 0x00, 0x00, 0x00 },
+      { 0x00, 0x00, 0x00, 0x01, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x01, 0x00, 0x00, 0x00 },
+      { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+   }
+};
+static const uint8_t point[BIG_DIGIT_PAGES] PROGMEM = { 0x00, 0x00, 0x00, 0x78 };   // 4 x 4, level with the bottom stroke
+#endif
+
+//************************************************************************************
+// One byte of a glyph: page 0 is the top, column 0 the left edge of the slot.  The
+// digit is followed by a blank column, the decimal point (if the glyph has one) and
+// another blank column before the next slot.
+//************************************************************************************
+uint8_t bigDigitColumn(uint8_t glyph, uint8_t page, uint8_t col) {
+   if(col < BIG_INK_WIDTH) {
+      uint8_t c = glyph & ~BIG_POINT;
+      uint8_t index;
+      if(c >= '0' && c <= '9') {
+         index = c - '0';
+      } else if(c == '-') {
+         index = BIG_GLYPHS - 1;
+      } else {
+         return 0;   // Blank, or something we have no glyph for
+      }
+      return pgm_read_byte(&glyphs[index][page][col]);
+   }
+   if((glyph & BIG_POINT) && col > BIG_INK_WIDTH && col <= BIG_INK_WIDTH + BIG_POINT_WIDTH) {
+      return pgm_read_byte(&point[page]);
+   }
+   return 0;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*******************************************************************************************************
+Text field that only rewrites what changed.  See DisplayField.h.
+*******************************************************************************************************/
+#include "DisplayField.h"
+
+void DisplayField::begin(uint8_t col, uint8_t row, uint8_t width, uint8_t size) {
+   this->col = col;
+   this->row = row;
+   this->width = width < DISPLAY_FIELD_MAX ? width : DISPLAY_FIELD_MAX;
+   this->size = size;
+   forget();
+   start();
+}
+
+void DisplayField::start() {
+   length = 0;
+   memset(text, ' ', sizeof(text));
+}
+
+void DisplayField::forget() {
+   memset(shown, ' ', sizeof(shown));
+}
+
+size_t DisplayField::write(uint8_t c) {
+   #ifdef BIG_DIGITS
+   if(size == BIG_DIGITS && c == '.' && length) {
+      text[length - 1] |= BIG_POINT;   // Shares the slot of the digit before it
+      return 1;
+   }
+   #endif
+   if(length < width) {
+      text[length++] = c;
+   }
+   return 1;
+}
+
+//************************************************************************************
+// Walk the field, sending each run of changed characters after a single cursor move.
+// The display is left in 2X, the way the rest of the code expects it.
+//************************************************************************************
+bool DisplayField::show(ShadowDisplay &oled) {
+   #ifdef BIG_DIGITS
+   if(size == BIG_DIGITS) {
+      return showBig(oled);
+   }
+   #endif
+   if(size == 1) {
+      oled.set1X();
+   }
+   bool cursorHere = false;   // The display's cursor is already at character i
+   bool sent = true;
+   for(uint8_t i = 0; sent && i < width; i++) {
+      if(text[i] == shown[i]) {
+         cursorHere = false;
+         continue;
+      }
+      if(!cursorHere) {
+         oled.setCursor(col + oled.fieldWidth(i), row);
+         cursorHere = true;
+      }
+      sent = oled.write(text[i]);
+      if(sent) {
+         shown[i] = text[i];
+      }
+   }
+   if(size == 1) {
+      oled.set2X();
+   }
+   return sent;
+}
+
+#ifdef BIG_DIGITS
+//************************************************************************************
+// Big digits, right-aligned.  Each changed slot goes over what was there, so only the
+// columns that differ are sent.
+//************************************************************************************
+bool DisplayField::showBig(ShadowDisplay &oled) {
+   if(length < width) {
+      memmove(text + width - length, text, length);
+      memset(text, ' ', width - length);
+   }
+   for(uint8_t i = 0; i < width; i++) {
+      if(text[i] != shown[i]) {
+         oled.setCursor(col + i * BIG_DIGIT_WIDTH, row);
+         if(!oled.writeBig(text[i], shown[i])) {
+            return false;
+         }
+         shown[i] = text[i];
+      }
+   }
+   return true;
+}
+#endif
@@ -0,0 +1,250 @@
+/*******************************************************************************************************
+Display command queue.  See DisplayQueue.h.
+*******************************************************************************************************/
+#include "DisplayQueue.h"
+
+// Printable characters go in the queue as themselves, everything else is a command
+const uint8_t CMD_1X = 0x80;
+const uint8_t CMD_2X = 0x81;
+const uint8_t CMD_CURSOR = 0x82;        // col, row
+const uint8_t CMD_CLEAR_FIELD = 0x83;   // col, row, n
+const uint8_t CMD_CLEAR_EOL = 0x84;
+const uint8_t CMD_CHAR = 0x85;          // c, for a character that looks like a command
+const uint8_t CMD_BIG = 0x86;           // col, row, glyph, old glyph
+
+const uint8_t CLEAR_PIECE = 1;          // Characters per piece of a field clear, no slower than writing one
+const uint8_t CHAR_WIDTH = 6;           // System5x7 plus letter spacing (see Hal.cpp)
+const uint8_t BIG_RUN_GAP = 3;          // Unchanged columns in a big digit cheaper to resend than to move the cursor past
+
+DisplayQueue::DisplayQueue(ScaleDisplay &panel) : panel(panel) {
+   sentMagnify = 1;
+   clearLeft = 0;
+   #ifdef BIG_DIGITS
+   bigPagesLeft = 0;
+   #endif
+   contrast = -1;
+   closed = false;
+   worstSlice = 0;
+   slowestSend = 0;
+   mostQueued = 0;
+   overflows = 0;
+}
+
+void DisplayQueue::begin() {
+   panel.begin();
+}
+
+bool DisplayQueue::set1X() {
+   return push(CMD_1X);
+}
+
+bool DisplayQueue::set2X() {
+   return push(CMD_2X);
+}
+
+bool DisplayQueue::setCursor(uint8_t col, uint8_t row) {
+   return push(CMD_CURSOR, col, row);
+}
+
+bool DisplayQueue::clearField(uint8_t col, uint8_t row, uint8_t n) {
+   return push(CMD_CLEAR_FIELD, col, row, n);
+}
+
+bool DisplayQueue::clearToEOL() {
+   return push(CMD_CLEAR_EOL);
+}
+
+#ifdef BIG_DIGITS
+bool DisplayQueue::writeBig(uint8_t col, uint8_t row, uint8_t glyph, uint8_t oldGlyph) {
+   return push(CMD_BIG, col, row, glyph, oldGlyph);
+}
+#endif
+
+size_t DisplayQueue::write(uint8_t c) {
+   return (c < CMD_1X ? push(c) : push(CMD_CHAR, c)) ? 1 : 0;
+}
+
+void DisplayQueue::setContrast(uint8_t value) {
+   contrast = value;
+}
+
+uint8_t DisplayQueue::room() {
+   return closed ? 0 : DISPLAY_QUEUE_SIZE - queue.count();
+}
+
+//************************************************************************************
+// Queue one command.  A command always goes in whole.  If there isn't room it's turned
+// away, and so is everything after it until the next slice has made some.
+//************************************************************************************
+bool DisplayQueue::push(uint8_t command, uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+   uint8_t length = command == CMD_BIG ? 5 : command == CMD_CLEAR_FIELD ? 4 : command == CMD_CURSOR ? 3 : command == CMD_CHAR ? 2 : 1;
+   if(room() < length) {
+      if(!closed) {
+         overflows++;
+         closed = true;
+      }
+      return false;
+   }
+   queue.push(command);
+   if(length > 1) {
+      queue.push(a);
+   }
+   if(length > 2) {
+      queue.push(b);
+   }
+   if(length > 3) {
+      queue.push(c);
+   }
+   if(length > 4) {
+      queue.push(d);
+   }
+   if(queue.count() > mostQueued) {
+      mostQueued = queue.count();
+   }
+   return true;
+}
+
+//************************************************************************************
+// Send the next command to the panel, or the next piece of a field clear or big digit.
+//************************************************************************************
+void DisplayQueue::sendNext() {
+   #ifdef BIG_DIGITS
+   if(bigPagesLeft) {
+      sendBigPage();
+      return;
+   }
+   #endif
+   if(clearLeft == 0) {
+      uint8_t command;
+      if(!queue.pop(command)) {
+         return;
+      }
+      uint8_t a = 0, b = 0;
+      switch(command) {
+         case CMD_1X:
+            panel.set1X();
+            sentMagnify = 1;
+            return;
+         case CMD_2X:
+            panel.set2X();
+            sentMagnify = 2;
+            return;
+         case CMD_CURSOR:
+            queue.pop(a);
+            queue.pop(b);
+            panel.setCursor(a, b);
+            return;
+         case CMD_CLEAR_FIELD:
+            queue.pop(clearCol);
+            queue.pop(clearRow);
+            queue.pop(clearLeft);
+            break;   // Send the first piece below
+         case CMD_CLEAR_EOL:
+            panel.clearToEOL();
+            return;
+         case CMD_CHAR:
+            queue.pop(a);
+            panel.write(a);
+            return;
+         #ifdef BIG_DIGITS
+         case CMD_BIG:
+            queue.pop(bigCol);
+            queue.pop(bigRow);
+            queue.pop(bigGlyph);
+            queue.pop(bigOld);
+            bigPagesLeft = BIG_DIGIT_PAGES;
+            sendBigPage();
+            return;
+         #endif
+         default:
+            panel.write(command);
+            return;
+      }
+   }
+   uint8_t n = clearLeft < CLEAR_PIECE ? clearLeft : CLEAR_PIECE;
+   panel.clearField(clearCol, clearRow, n);
+   clearCol += n * CHAR_WIDTH * sentMagnify;
+   clearLeft -= n;
+}
+
+#ifdef BIG_DIGITS
+//************************************************************************************
+// One page of a big digit: just the columns that differ from the glyph that was there,
+// in runs, each after a cursor move.
+//************************************************************************************
+void DisplayQueue::sendBigPage() {
+   uint8_t page = BIG_DIGIT_PAGES - bigPagesLeft;
+   uint8_t first = 0;
+   uint8_t n = 0;
+   uint8_t same = 0;     // Unchanged columns since the last changed one in the run
+   for(uint8_t col = 0; col <= BIG_DIGIT_WIDTH; col++) {
+      if(col < BIG_DIGIT_WIDTH && bigDigitColumn(bigGlyph, page, col) != bigDigitColumn(bigOld, page, col)) {
+         if(n == 0) {
+            first = col;
+         }
+         n += same + 1;
+         same = 0;
+      } else if(n && (++same > BIG_RUN_GAP || col == BIG_DIGIT_WIDTH)) {
+         panel.setCursor(bigCol + first, bigRow + page);
+         panel.writeBig(bigGlyph, page, first, n);
+         n = 0;
+         same = 0;
+      }
+   }
+   bigPagesLeft--;
+}
+#endif
+
+//************************************************************************************
+// One slice of sending.  Stops before the next command could take it over the budget,
+// going by the slowest one so far (ISRs and all), but always sends at least one so there's progress
+// however small the budget.  Whatever was turned away can try again after it.
+//************************************************************************************
+bool DisplayQueue::service(uint16_t budgetUs) {
+   closed = false;
+   if(!pending() && contrast < 0) {
+      return false;
+   }
+   uint32_t start = micros();
+   uint32_t elapsed;
+   if(contrast >= 0) {
+      panel.setContrast(contrast);
+      contrast = -1;
+   }
+   uint32_t last = start;
+   do {
+      sendNext();
+      uint32_t now = micros();
+      if(now - last > slowestSend) {   // Counting any ISR that got in, it's all time out of the pass
+         slowestSend = now - last > 0xFFFF ? 0xFFFF : now - last;
+      }
+      last = now;
+      elapsed = now - start;
+   } while(pending() && elapsed + slowestSend <= budgetUs);
+   if(elapsed > worstSlice) {
+      worstSlice = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+   }
+   return pending();
+}
+
+void DisplayQueue::drain() {
+   if(contrast >= 0) {
+      panel.setContrast(contrast);
+      contrast = -1;
+   }
+   while(pending()) {
+      sendNext();
+   }
+   closed = false;
+}
+
+void DisplayQueue::report(Print &out) {
+   out.print(F("display: worst slice "));
+   out.print(worstSlice);
+   out.print(F(" us, most queued "));
+   out.print(mostQueued);
+   out.print('/');
+   out.print(DISPLAY_QUEUE_SIZE);
+   out.print(F(", overflows "));
+   out.println(overflows);
+}
@@ -0,0 +1,143 @@
+/*******************************************************************************************************
+Filter chain between the raw HX711 counts and the weight.  See Filters.h for the overview.
+*******************************************************************************************************/
+#include "Filters.h"
+
+const uint8_t IIR_FRACTION_BITS = 4;   // 24-bit counts << 4 still fits in an int32
+
+//************************************************************************************
+// Median-of-N.  N is tiny (3 to 7) so an insertion sort of a copy is the cheapest way.
+// Until N samples have come in, the median of what we have is used.
+//************************************************************************************
+MedianFilter::MedianFilter() {
+   reset();
+}
+
+void MedianFilter::reset() {
+   index = 0;
+   count = 0;
+}
+
+int32_t MedianFilter::process(int32_t x) {
+   #if FILTER_MEDIAN_SIZE == 1
+   return x;
+   #else
+   history[index] = x;
+   index = (index + 1) % FILTER_MEDIAN_SIZE;
+   if(count < FILTER_MEDIAN_SIZE) {
+      count++;
+   }
+
+   int32_t sorted[FILTER_MEDIAN_SIZE];
+   for(uint8_t i = 0; i < count; i++) {
+      int32_t v = history[i];
+      uint8_t j = i;
+      while(j > 0 && sorted[j - 1] > v) {
+         sorted[j] = sorted[j - 1];
+         j--;
+      }
+      sorted[j] = v;
+   }
+   return sorted[count / 2];
+   #endif
+}
+
+//************************************************************************************
+// Moving average that starts over when the input steps
+//************************************************************************************
+StepAverage::StepAverage() {
+   stepThreshold = 0;
+   reset();
+}
+
+void StepAverage::reset() {
+   sum = 0;
+   index = 0;
+   count = 0;
+   stepFlag = false;
+}
+
+void StepAverage::setStepThreshold(int32_t counts) {
+   stepThreshold = counts;
+}
+
+int32_t StepAverage::process(int32_t x) {
+   // A jump bigger than the threshold means the load changed.  Everything in the window
+   // is from the old load, so drop it and start again from this sample.
+   stepFlag = false;
+   if(stepThreshold > 0 && count > 0) {
+      int32_t diff = x - value();
+      if(diff > stepThreshold || diff < -stepThreshold) {
+         reset();
+         stepFlag = true;
+      }
+   }
+
+   if(count == FILTER_AVERAGE_SIZE) {
+      sum -= dataSet[index];
+   } else {
+      count++;
+   }
+   dataSet[index] = x;
+   sum += x;
+   index = (index + 1) % FILTER_AVERAGE_SIZE;
+   return value();
+}
+
+int32_t StepAverage::value() const {
+   if(count == FILTER_AVERAGE_SIZE) {
+      return sum / FILTER_AVERAGE_SIZE;   // Constant divide, so a shift when the window is a power of two
+   }
+   if(count == 0) {
+      return 0;
+   }
+   return sum / count;
+}
+
+//************************************************************************************
+// First-order IIR low-pass
+//************************************************************************************
+IirFilter::IirFilter() {
+   state = 0;
+   primed = false;
+}
+
+void IirFilter::reset(int32_t x) {
+   state = x * (1 << IIR_FRACTION_BITS);
+   primed = true;
+}
+
+int32_t IirFilter::process(int32_t x) {
+   if(!primed) {
+      reset(x);
+   }
+   state += (x * (1 << IIR_FRACTION_BITS) - state) >> FILTER_IIR_SHIFT;
+   return value();
+}
+
+int32_t IirFilter::value() const {
+   return (state + (1 << (IIR_FRACTION_BITS - 1))) >> IIR_FRACTION_BITS;
+}
+
+//************************************************************************************
+// The whole chain
+//************************************************************************************
+int32_t FilterChain::process(int32_t raw) {
+   int32_t x = average.process(median.process(raw));
+   #if FILTER_IIR_SHIFT == 0
+   output = x;
+   #else
+   if(average.stepped()) {
+      iir.reset(x);
+   }
+   output = iir.process(x);
+   #endif
+   return output;
+}
+
+void FilterChain::reset() {
+   median.reset();
+   average.reset();
+   iir = IirFilter();
+   output = 0;
+}
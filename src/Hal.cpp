@@ -0,0 +1,247 @@
+/*******************************************************************************************************
+Hardware abstraction for the scale, Nano implementation.  See Hal.h for the overview.
+*******************************************************************************************************/
+#include "ScaleConfig.h"
+#include "Board.h"
+#include "Hal.h"
+
+#ifdef ARDUINO
+
+#include <SPI.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <TimerOne.h>
+#include <ClickEncoder.h>
+#include "SSD1306Ascii.h"
+#include "SSD1306AsciiSpi.h"
+#include "SSD1306AsciiAvrI2c.h"
+#include "OledBus.h"
+#include "BigDigits.h"
+
+// Our own transport, the library's, or both for the benchmark to compare (see OledBus.h)
+#if defined(FAST_OLED_BUS) || defined(DISPLAY_BENCHMARK)
+#define USE_FAST_OLED
+#endif
+#if !defined(FAST_OLED_BUS) || defined(DISPLAY_BENCHMARK)
+#define USE_LIBRARY_OLED
+#endif
+
+// The panel's transports, ours and the library's, for an SPI or an I2C board.  Only
+// the board's own gets compiled.
+template <class B, bool Spi = B::OLED_SPI>
+struct OledBus;
+
+template <class B>
+struct OledBus<B, true> {
+   typedef SpiOled<B::OLED_CS_PIN, B::OLED_DC_PIN, B::OLED_RST_PIN> Fast;
+   typedef SSD1306AsciiSpi Library;
+   static const uint32_t HZ = OLED_SPI_HZ;
+
+   static void begin(Fast &oled, uint32_t hz) {
+      oled.begin(&SH1106_128x64, hz);
+   }
+   static void begin(Library &oled) {
+      oled.begin(&SH1106_128x64, B::OLED_CS_PIN, B::OLED_DC_PIN, B::OLED_RST_PIN);
+   }
+   static void release(Fast &oled) {
+   }
+};
+
+template <class B>
+struct OledBus<B, false> {
+   typedef I2cOled Fast;
+   typedef SSD1306AsciiAvrI2c Library;
+   static const uint32_t HZ = OLED_I2C_HZ;
+
+   static void begin(Fast &oled, uint32_t hz) {
+      oled.begin(&SH1106_128x64, B::OLED_I2C_ADDRESS, hz);
+   }
+   static void begin(Library &oled) {
+      oled.begin(&SH1106_128x64, B::OLED_I2C_ADDRESS);
+   }
+   static void release(Fast &oled) {
+      oled.endTransfer();   // The library's own TWI code takes over
+   }
+};
+
+typedef OledBus<Board> Oled;
+
+#ifdef USE_FAST_OLED
+static Oled::Fast fastOled;
+#endif
+#ifdef USE_LIBRARY_OLED
+static Oled::Library libraryOled;   // Create an instance of the OLED object
+#endif
+
+static SSD1306Ascii *oled;   // Whichever of them is driving the panel
+
+//************************************************************************************
+// Display
+//************************************************************************************
+#ifdef USE_FAST_OLED
+static void useFastOled(uint32_t hz) {
+   Oled::begin(fastOled, hz);
+   fastOled.setFont(System5x7);
+   oled = &fastOled;
+}
+#endif
+
+#ifdef USE_LIBRARY_OLED
+static void useLibraryOled() {
+   #ifdef USE_FAST_OLED
+   Oled::release(fastOled);
+   #endif
+   Oled::begin(libraryOled);
+   libraryOled.setFont(System5x7);
+   oled = &libraryOled;
+}
+#endif
+
+void ScaleDisplay::begin() {
+   #ifdef FAST_OLED_BUS
+   useFastOled(Oled::HZ);
+   #else
+   useLibraryOled();
+   #endif
+}
+
+#ifdef DISPLAY_BENCHMARK
+// What the benchmark runs through.  0 Hz is the library's transport at its own settings.
+struct BusSetting {
+   char name[10];
+   uint32_t hz;
+};
+
+// The other board's table isn't used, so it's left out of the link.
+static const BusSetting spiBusTable[] PROGMEM = {
+   { "library", 0 },
+   { "spi 4MHz", 4000000 },
+   { "spi 8MHz", 8000000 }
+};
+static const BusSetting i2cBusTable[] PROGMEM = {
+   { "library", 0 },
+   { "i2c 400k", 400000 },
+   { "i2c 800k", 800000 }
+};
+static const BusSetting *const busTable = Board::OLED_SPI ? spiBusTable : i2cBusTable;
+const uint8_t BUS_SETTINGS = 3;
+
+uint8_t ScaleDisplay::busSettings() {
+   return BUS_SETTINGS;
+}
+
+const __FlashStringHelper *ScaleDisplay::useBusSetting(uint8_t n) {
+   uint32_t hz = pgm_read_dword(&busTable[n].hz);
+   if(hz) {
+      useFastOled(hz);
+   } else {
+      useLibraryOled();
+   }
+   oled->clear();
+   return (const __FlashStringHelper *)busTable[n].name;
+}
+#endif
+
+void ScaleDisplay::clear() {
+   oled->clear();
+}
+
+void ScaleDisplay::set1X() {
+   oled->set1X();
+}
+
+void ScaleDisplay::set2X() {
+   oled->set2X();
+}
+
+void ScaleDisplay::setCursor(uint8_t col, uint8_t row) {
+   oled->setCursor(col, row);
+}
+
+void ScaleDisplay::clearField(uint8_t col, uint8_t row, uint8_t n) {
+   oled->clearField(col, row, n);
+}
+
+void ScaleDisplay::clearToEOL() {
+   oled->clearToEOL();
+}
+
+uint8_t ScaleDisplay::fontRows() {
+   return oled->fontRows();
+}
+
+uint8_t ScaleDisplay::fieldWidth(uint8_t n) {
+   return oled->fieldWidth(n);
+}
+
+size_t ScaleDisplay::write(uint8_t c) {
+   return oled->write(c);
+}
+
+void ScaleDisplay::setContrast(uint8_t value) {
+   oled->setContrast(value);
+}
+
+#ifdef BIG_DIGITS
+void ScaleDisplay::writeBig(uint8_t glyph, uint8_t page, uint8_t first, uint8_t n) {
+   for(uint8_t col = first; col < first + n; col++) {
+      oled->ssd1306WriteRam(bigDigitColumn(glyph, page, col));
+   }
+}
+#endif
+
+//************************************************************************************
+// Knob
+//************************************************************************************
+static ClickEncoder *encoder;
+
+static_assert((int)ClickEncoder::Clicked == KNOB_CLICKED && (int)ClickEncoder::DoubleClicked == KNOB_DOUBLE_CLICKED,
+              "KnobButton has to match ClickEncoder::Button");
+
+void ScaleKnob::begin(uint8_t pinA, uint8_t pinB, uint8_t pinSw, uint8_t stepsPerNotch) {
+   // Enable the Arduino builtin pullup resistors.
+   pinMode(pinA, INPUT_PULLUP);
+   pinMode(pinB, INPUT_PULLUP);
+   pinMode(pinSw, INPUT_PULLUP);
+   encoder = new ClickEncoder(pinA, pinB, pinSw, stepsPerNotch);
+   encoder->setAccelerationEnabled(false);  // Don't want acceleration
+}
+
+void ScaleKnob::service() {
+   encoder->service();
+}
+
+int16_t ScaleKnob::getValue() {
+   return encoder->getValue();
+}
+
+KnobButton ScaleKnob::getButton() {
+   return (KnobButton)encoder->getButton();
+}
+
+//************************************************************************************
+// Timer
+//************************************************************************************
+void ScaleTimer::begin(unsigned long periodUs, void (*isr)()) {
+   Timer1.initialize(periodUs);
+   Timer1.attachInterrupt(isr);
+}
+
+//************************************************************************************
+// Storage
+//************************************************************************************
+void ScaleStorage::read(int address, void *data, uint8_t len) {
+   uint8_t *p = (uint8_t *)data;
+   for(uint8_t i = 0; i < len; i++) {
+      p[i] = EEPROM.read(address + i);
+   }
+}
+
+void ScaleStorage::write(int address, const void *data, uint8_t len) {
+   const uint8_t *p = (const uint8_t *)data;
+   for(uint8_t i = 0; i < len; i++) {
+      EEPROM.update(address + i, p[i]);
+   }
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*******************************************************************************************************
+Interrupt-driven HX711 acquisition.  See Hx711Isr.h for the overview.
+*******************************************************************************************************/
+#include "ScaleConfig.h"
+
+#if defined(HX711_ISR_MODE) && defined(ARDUINO)   // The native build has a simulated one in lib/NativeSim
+
+#include <Arduino.h>
+#include <util/atomic.h>
+#include "Board.h"
+#include "Hx711Isr.h"
+
+// Direct port access.  digitalRead/Write are too slow for 25 clocks in an ISR.
+typedef FastPin<Board::HX711_DOUT> Dout;
+typedef FastPin<Board::HX711_SCK> Sck;
+
+// Channel A, gain 128.  The number of extra clocks after the 24 data bits selects the
+// channel/gain of the next conversion (1 = A/128, 2 = B/32, 3 = A/64).
+const uint8_t HX711_GAIN_PULSES = 1;
+
+SampleRing<Hx711Sample, HX711_RING_SIZE> Hx711Isr::ring;
+volatile uint32_t Hx711Isr::capturedCount = 0;
+volatile uint16_t Hx711Isr::overrunCount = 0;
+
+//************************************************************************************
+// Set up the pins, power up the HX711 and enable the pin-change interrupt on DOUT
+//************************************************************************************
+void Hx711Isr::begin() {
+   Sck::low();   // SCK low powers up the HX711 (held high > 60us powers it down)
+   Sck::output();
+   Dout::input();
+
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      Dout::pcmsk() |= Dout::MASK;
+      PCIFR = _BV(Dout::PCIE_BIT);     // Drop any stale pin-change flag
+      PCICR |= _BV(Dout::PCIE_BIT);
+
+      // If a conversion was already waiting, DOUT is sitting low and we will never see
+      // the falling edge.  Read it now so the HX711 starts the next conversion.
+      handleInterrupt();
+   }
+}
+
+//************************************************************************************
+// Pop the oldest captured sample.  Returns false if nothing is waiting.
+//************************************************************************************
+bool Hx711Isr::read(Hx711Sample &sample) {
+   return ring.pop(sample);
+}
+
+uint8_t Hx711Isr::waiting() {
+   return ring.count();
+}
+
+uint32_t Hx711Isr::captured() {
+   uint32_t count;
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      count = capturedCount;
+   }
+   return count;
+}
+
+uint16_t Hx711Isr::overruns() {
+   uint16_t count;
+   ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      count = overrunCount;
+   }
+   return count;
+}
+
+//************************************************************************************
+// Clock out one conversion.  Runs with interrupts off, takes roughly 60us.
+//************************************************************************************
+void Hx711Isr::handleInterrupt() {
+   // Pin change fires on both edges.  Only a low DOUT means there is data to read.
+   if(Dout::read()) {
+      return;
+   }
+
+   uint32_t value = 0;
+   for(uint8_t i = 0; i < 24 + HX711_GAIN_PULSES; i++) {
+      Sck::high();
+      delayMicroseconds(1);
+      if(i < 24) {
+         value = (value << 1) | (Dout::read() ? 1 : 0);
+      }
+      Sck::low();
+      delayMicroseconds(1);
+   }
+
+   // DOUT toggled while we were clocking bits out, which left the pin-change flag set.
+   // Clear it so we don't come right back in here for our own edges.
+   PCIFR = _BV(Dout::PCIE_BIT);
+
+   // Sign-extend the 24-bit two's complement result
+   if(value & 0x800000UL) {
+      value |= 0xFF000000UL;
+   }
+
+   Hx711Sample sample;
+   sample.raw = (int32_t)value;
+   sample.time = millis();
+   capturedCount++;
+   if(!ring.push(sample)) {
+      overrunCount++;
+   }
+}
+
+// All three pin-change vectors land here so DOUT can be on any port.  Only the
+// DOUT pin is enabled in the PCMSK registers.
+ISR(PCINT0_vect) {
+   Hx711Isr::handleInterrupt();
+}
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+
+#endif
@@ -0,0 +1,208 @@
+/*******************************************************************************************************
+Load cell front end for the interrupt-driven HX711 acquisition.  See IsrLoadCell.h for the overview.
+*******************************************************************************************************/
+#include <Arduino.h>
+#include "IsrLoadCell.h"
+
+#ifdef HX711_ISR_MODE
+
+IsrLoadCell::IsrLoadCell() {
+   tareOffset = 0;
+   setCalFactor(DECIMAL_ONE);
+   tarePending = false;
+   tareDone = false;
+   consumedCount = 0;
+   stepCount = 0;
+   sampleHandler = 0;
+   rawHandler = 0;
+}
+
+//************************************************************************************
+// Start the ISR capture.  Safe to call again.
+//************************************************************************************
+void IsrLoadCell::begin() {
+   Hx711Isr::begin();
+}
+
+//************************************************************************************
+// Let the load cell settle for stabilizingTime ms, then optionally zero it out.
+// Blocks, same as the HX711_ADC version.
+//************************************************************************************
+void IsrLoadCell::start(unsigned long stabilizingTime, bool doTare) {
+   unsigned long startTime = millis();
+   while(millis() - startTime < stabilizingTime) {
+      update();
+   }
+   if(doTare) {
+      refreshDataSet();
+      tareOffset = smoothedData();
+   }
+}
+
+//************************************************************************************
+// Run everything the ISR has captured through the filter chain
+//************************************************************************************
+uint8_t IsrLoadCell::update() {
+   Hx711Sample sample;
+   uint8_t newData = 0;
+   while(Hx711Isr::read(sample)) {
+      if(rawHandler) {
+         rawHandler(sample.raw, sample.time);
+      }
+      filter.process(sample.raw);
+      if(filter.stepped()) {
+         stepCount++;
+      }
+      consumedCount++;
+      newData = 1;
+      if(sampleHandler) {
+         sampleHandler(getData(), sample.time);
+      }
+   }
+   if(tarePending && filter.isSettled()) {
+      tareOffset = smoothedData();
+      tarePending = false;
+      tareDone = true;
+   }
+   return newData;
+}
+
+void IsrLoadCell::setSampleHandler(SampleHandler handler) {
+   sampleHandler = handler;
+}
+
+void IsrLoadCell::setRawHandler(RawHandler handler) {
+   rawHandler = handler;
+}
+
+weight_t IsrLoadCell::getData() {
+   #ifdef FLOAT_WEIGHT_MATH
+   return (float)(smoothedData() - tareOffset) / calFactor;
+   #else
+   return countsToPounds(smoothedData() - tareOffset, weightScale);
+   #endif
+}
+
+//************************************************************************************
+// The filter's step threshold is in counts, so it follows the cal factor
+//************************************************************************************
+void IsrLoadCell::setCalFactor(decimal_t cal) {
+   calFactor = cal;
+   #ifdef FLOAT_WEIGHT_MATH
+   int32_t stepCounts = abs(cal) * FILTER_STEP_CENTI / 100;
+   #else
+   setWeightScale(weightScale, cal);
+   int32_t stepCounts = (int32_t)((int64_t)abs(cal) * FILTER_STEP_CENTI / 10000);
+   #endif
+   if(FILTER_STEP_CENTI == 0) {
+      stepCounts = 0;
+   } else if(stepCounts < FILTER_STEP_MIN_COUNTS) {
+      stepCounts = FILTER_STEP_MIN_COUNTS;
+   }
+   filter.setStepThreshold(stepCounts);
+}
+
+decimal_t IsrLoadCell::getCalFactor() {
+   return calFactor;
+}
+
+//************************************************************************************
+// Zero the scale without blocking.  The filter is restarted so the new offset is
+// only taken from samples captured after the request.
+//************************************************************************************
+void IsrLoadCell::tareNoDelay() {
+   update();   // What's already waiting was captured before the request
+   filter.reset();
+   tarePending = true;
+   tareDone = false;
+}
+
+bool IsrLoadCell::getTareStatus() {
+   bool done = tareDone;
+   tareDone = false;
+   return done;
+}
+
+void IsrLoadCell::cancelTare() {
+   tarePending = false;
+   tareDone = false;
+}
+
+int32_t IsrLoadCell::getTareOffset() {
+   return tareOffset;
+}
+
+void IsrLoadCell::setTareOffset(int32_t offset) {
+   tareOffset = offset;
+}
+
+//************************************************************************************
+// Throw away the filter history and wait until it has settled on new samples
+//************************************************************************************
+void IsrLoadCell::refreshDataSet() {
+   restartDataSet();
+   while(!getDataSetStatus()) {
+      update();
+   }
+}
+
+//************************************************************************************
+// Throw away the filter history so the next full window is all fresh samples.
+// Doesn't wait - the caller polls getDataSetStatus() while it gets on with other things.
+// Whatever the ISR has already captured is consumed first, so the trace, the stability
+// detector and the sample consumers still see every conversion.  It just doesn't count
+// towards the new window.
+//************************************************************************************
+void IsrLoadCell::restartDataSet() {
+   update();
+   filter.reset();
+}
+
+bool IsrLoadCell::getDataSetStatus() {
+   return filter.isSettled();
+}
+
+uint8_t IsrLoadCell::getDataSetCount() {
+   return filter.windowSize();
+}
+
+uint8_t IsrLoadCell::getSamplesInUse() {
+   return FILTER_AVERAGE_SIZE;
+}
+
+//************************************************************************************
+// Calibration factor is counts per unit weight of the known reference
+//************************************************************************************
+decimal_t IsrLoadCell::getNewCalibration(decimal_t knownMass) {
+   #ifdef FLOAT_WEIGHT_MATH
+   setCalFactor((float)(smoothedData() - tareOffset) / knownMass);
+   #else
+   setCalFactor(calFromReference(smoothedData() - tareOffset, knownMass));
+   #endif
+   return calFactor;
+}
+
+uint32_t IsrLoadCell::getSamplesConsumed() {
+   return consumedCount;
+}
+
+uint32_t IsrLoadCell::getSamplesCaptured() {
+   return Hx711Isr::captured();
+}
+
+uint16_t IsrLoadCell::getOverruns() {
+   return Hx711Isr::overruns();
+}
+
+uint16_t IsrLoadCell::getSteps() {
+   return stepCount;
+}
+
+int32_t IsrLoadCell::smoothedData() {
+   if(filter.windowSize() == 0) {
+      return tareOffset;   // Nothing since the last restart, read as zero
+   }
+   return filter.value();
+}
+
+#endif
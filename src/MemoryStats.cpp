@@ -0,0 +1,86 @@
+/*******************************************************************************************************
+RAM and stack telemetry.  See MemoryStats.h.
+*******************************************************************************************************/
+#include "MemoryStats.h"
+
+#ifdef MEMORY_STATS
+
+#ifdef ARDUINO
+
+const uint8_t STACK_PAINT = 0xC5;
+
+// Where the linker and malloc() put things
+extern uint8_t __data_start;   // Start of RAM, .data first
+extern uint8_t __heap_start;   // End of .bss
+extern uint8_t __stack;        // Top of RAM
+extern char *__brkval;         // Top of the heap, 0 until the first malloc()
+
+// Paint everything above .bss.  This runs in .init3, after the stack pointer is set up
+// but before .data and .bss are and long before main(), so nothing is using any of it
+// yet.  It's naked and can't call anything - there's no return, the init sections just
+// run on into each other.
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack() {
+   uint8_t *p = &__heap_start;
+   while(p <= &__stack) {
+      *p++ = STACK_PAINT;
+   }
+}
+
+bool readMemoryStats(MemoryStats &stats) {
+   uint8_t *heapTop = __brkval ? (uint8_t *)__brkval : &__heap_start;
+   uint8_t *stackPointer = (uint8_t *)(uintptr_t)SP;   // The next byte the stack will use
+   uint8_t *ramEnd = (uint8_t *)(uintptr_t)RAMEND;
+
+   // The lowest byte the stack has touched is the first one up from the heap that isn't paint
+   uint8_t *p = heapTop;
+   while(p <= stackPointer && *p == STACK_PAINT) {
+      p++;
+   }
+
+   stats.total = ramEnd + 1 - &__data_start;
+   stats.staticRam = &__heap_start - &__data_start;
+   stats.heap = heapTop - &__heap_start;
+   stats.stack = ramEnd - stackPointer;
+   stats.free = stackPointer + 1 - heapTop;
+   stats.stackPeak = ramEnd + 1 - p;
+   stats.leastFree = p - heapTop;
+   return true;
+}
+
+#else
+
+bool readMemoryStats(MemoryStats &stats) {
+   return false;
+}
+
+#endif
+
+//************************************************************************************
+// One line for the serial port:
+//    ram 2048: static 1355, heap 13, stack 42 (peak 254), free 638 (least 426)
+//************************************************************************************
+void reportMemory(Print &out) {
+   MemoryStats stats;
+   if(!readMemoryStats(stats)) {
+      out.println(F("ram: nothing to measure on this build"));
+      return;
+   }
+   out.print(F("ram "));
+   out.print(stats.total);
+   out.print(F(": static "));
+   out.print(stats.staticRam);
+   out.print(F(", heap "));
+   out.print(stats.heap);
+   out.print(F(", stack "));
+   out.print(stats.stack);
+   out.print(F(" (peak "));
+   out.print(stats.stackPeak);
+   out.print(F("), free "));
+   out.print(stats.free);
+   out.print(F(" (least "));
+   out.print(stats.leastFree);
+   out.println(')');
+}
+
+#endif
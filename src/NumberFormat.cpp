@@ -0,0 +1,61 @@
+/*******************************************************************************************************
+Integer number formatting.  See NumberFormat.h.
+*******************************************************************************************************/
+#include "NumberFormat.h"
+
+const uint8_t MAX_DIGITS = 10;            // 4294967295
+static const uint32_t powersOfTen[MAX_DIGITS] PROGMEM = {
+   1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+//************************************************************************************
+// Digits most significant first, each one by subtracting its power of ten until it
+// won't go.  Leading zeros are skipped down to the ones digit, so there's always at
+// least "0" ahead of the point.
+//************************************************************************************
+uint8_t formatFixed(char *buf, int32_t value, uint8_t decimals, uint8_t width) {
+   if(decimals > NUMBER_MAX_DECIMALS) {
+      decimals = NUMBER_MAX_DECIMALS;
+   }
+   uint32_t n = value < 0 ? -(uint32_t)value : (uint32_t)value;
+   uint8_t length = 0;
+   if(value < 0) {
+      buf[length++] = '-';
+   }
+   bool started = false;
+   for(uint8_t i = 0; i < MAX_DIGITS; i++) {
+      uint8_t place = MAX_DIGITS - 1 - i;   // This digit is worth 10^place units
+      uint32_t power = pgm_read_dword(&powersOfTen[i]);
+      char digit = '0';
+      while(n >= power) {
+         n -= power;
+         digit++;
+      }
+      if(digit != '0' || place <= decimals) {
+         started = true;
+      }
+      if(started) {
+         if(decimals && place == decimals - 1) {
+            buf[length++] = '.';
+         }
+         buf[length++] = digit;
+      }
+   }
+
+   if(width > NUMBER_BUFFER_SIZE - 1) {
+      width = NUMBER_BUFFER_SIZE - 1;
+   }
+   if(length < width) {
+      memmove(buf + width - length, buf, length);
+      memset(buf, ' ', width - length);
+      length = width;
+   }
+   buf[length] = 0;
+   return length;
+}
+
+size_t printFixed(Print &out, int32_t value, uint8_t decimals, uint8_t width) {
+   char buf[NUMBER_BUFFER_SIZE];
+   uint8_t length = formatFixed(buf, value, decimals, width);
+   return out.write((const uint8_t *)buf, length);
+}
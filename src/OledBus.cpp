@@ -0,0 +1,69 @@
+/*******************************************************************************************************
+Faster bus code for the OLED.  See OledBus.h.  SpiOled is a template, it's all in there.
+*******************************************************************************************************/
+#include "OledBus.h"
+
+#ifdef ARDUINO   // The native build simulates the panel in lib/NativeSim
+
+//************************************************************************************
+// I2C.  The control byte after the address says whether what follows is commands
+// (0x00) or display data (0x40), for the rest of the transfer.
+//************************************************************************************
+const uint8_t I2C_CONTROL_CMD = 0x00;
+const uint8_t I2C_CONTROL_DATA = 0x40;
+const uint8_t NOT_OPEN = 0xFF;
+
+void I2cOled::begin(const DevType *dev, uint8_t i2cAddress, uint32_t hz) {
+   address = i2cAddress;
+   openControl = NOT_OPEN;
+   digitalWrite(SDA, HIGH);   // Weak pull-ups, the same as Wire
+   digitalWrite(SCL, HIGH);
+   TWSR = 0;                  // Prescaler 1
+   TWBR = (F_CPU / hz - 16) / 2;
+   TWCR = _BV(TWEN);
+   init(dev);
+}
+
+void I2cOled::writeDisplay(uint8_t b, uint8_t mode) {
+   uint8_t control = mode == SSD1306_MODE_CMD ? I2C_CONTROL_CMD : I2C_CONTROL_DATA;
+   if(openControl != control) {
+      if(openControl != NOT_OPEN) {
+         stop();
+      }
+      start(control);
+   }
+   send(b);
+}
+
+void I2cOled::endTransfer() {
+   if(openControl != NOT_OPEN) {
+      stop();
+   }
+}
+
+void I2cOled::start(uint8_t control) {
+   TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN);
+   while(!(TWCR & _BV(TWINT))) {
+   }
+   send(address << 1);   // Write
+   send(control);
+   openControl = control;
+}
+
+// A missing ACK doesn't stop us.  The panel would just miss the bytes, the same as
+// with the library, and the bus is never left waiting.
+void I2cOled::send(uint8_t b) {
+   TWDR = b;
+   TWCR = _BV(TWINT) | _BV(TWEN);
+   while(!(TWCR & _BV(TWINT))) {
+   }
+}
+
+void I2cOled::stop() {
+   TWCR = _BV(TWINT) | _BV(TWSTO) | _BV(TWEN);
+   while(TWCR & _BV(TWSTO)) {
+   }
+   openControl = NOT_OPEN;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*******************************************************************************************************
+Hot-path profiling counters.  See Profiler.h.
+*******************************************************************************************************/
+#include "Profiler.h"
+
+#ifdef PROFILING
+
+ProfileStats Profiler::stats[PROFILE_SECTIONS];
+
+static const char sectionNames[] PROGMEM = "loop   \0loadcel\0weights\0menu   \0battery\0encoder\0timer  \0display";
+const uint8_t SECTION_NAME_SIZE = 8;
+
+void Profiler::reset() {
+   for(uint8_t i = 0; i < PROFILE_SECTIONS; i++) {
+      noInterrupts();      // The timer ISR records into its own entry
+      stats[i].count = 0;
+      stats[i].max = 0;
+      stats[i].total = 0;
+      interrupts();
+   }
+}
+
+//************************************************************************************
+// One line per section: calls, min, average and max us since the last report.
+//************************************************************************************
+void Profiler::report(Print &out) {
+   out.println(F("section  calls  min  avg  max"));
+   for(uint8_t i = 0; i < PROFILE_SECTIONS; i++) {
+      noInterrupts();
+      ProfileStats s = stats[i];
+      interrupts();
+
+      out.print((const __FlashStringHelper *)&sectionNames[i * SECTION_NAME_SIZE]);
+      out.print(F("  "));
+      out.print(s.count);
+      out.print(F("  "));
+      if(s.count) {
+         out.print(s.min);
+         out.print(F("  "));
+         out.print(s.total / s.count);
+         out.print(F("  "));
+         out.println(s.max);
+      } else {
+         out.println(F("-  -  -"));
+      }
+   }
+   reset();
+}
+
+#endif
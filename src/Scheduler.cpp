@@ -0,0 +1,128 @@
+/*******************************************************************************************************
+Cooperative periodic task scheduler.  See Scheduler.h for the overview.
+*******************************************************************************************************/
+#include "Scheduler.h"
+
+// part/whole as a percentage with one decimal, no floats
+static void printTenths(Print &out, uint32_t part, uint32_t whole) {
+   uint16_t tenths = whole ? (uint16_t)((uint64_t)part * 1000 / whole) : 0;
+   out.print(tenths / 10);
+   out.print('.');
+   out.print(tenths % 10);
+}
+
+Scheduler::Scheduler() {
+   numTasks = 0;
+   intervalStart = 0;
+}
+
+//************************************************************************************
+// Add a task.  It first runs on the next runNext() call, then every periodMs.
+//************************************************************************************
+int8_t Scheduler::addTask(void (*run)(), const __FlashStringHelper *name, uint16_t periodMs, uint8_t priority) {
+   if(numTasks >= SCHEDULER_MAX_TASKS) {
+      return -1;
+   }
+   SchedulerTask &t = tasks[numTasks];
+   t.run = run;
+   t.name = name;
+   t.period = periodMs;
+   t.priority = priority;
+   t.due = millis();
+   t.wcet = 0;
+   t.busy = 0;
+   t.runs = 0;
+   t.missed = 0;
+   return numTasks++;
+}
+
+//************************************************************************************
+// Change a task's period.  If the next run is further off than the new period, it
+// runs on the next runNext() instead, so speeding up takes effect straight away.
+//************************************************************************************
+void Scheduler::setPeriod(int8_t id, uint16_t periodMs) {
+   if(id < 0 || id >= numTasks) {
+      return;
+   }
+   SchedulerTask &t = tasks[id];
+   uint32_t now = millis();
+   if((int32_t)(t.due - now) > (int32_t)periodMs) {
+      t.due = now;
+   }
+   t.period = periodMs;
+}
+
+//************************************************************************************
+// Pick the most important task whose deadline has come and run it.  Ties go to
+// whichever was added first.
+//************************************************************************************
+bool Scheduler::runNext() {
+   uint32_t now = millis();
+   SchedulerTask *next = 0;
+   for(uint8_t i = 0; i < numTasks; i++) {
+      SchedulerTask &t = tasks[i];
+      if((int32_t)(now - t.due) >= 0 && (next == 0 || t.priority < next->priority)) {
+         next = &t;
+      }
+   }
+   if(next == 0) {
+      return false;
+   }
+
+   // Late by a whole period means a run was skipped.  Don't try to catch up with a burst
+   // of back-to-back runs, just start the period over from now.
+   uint32_t late = now - next->due;
+   if(late >= next->period) {
+      if(next->period > 0) {
+         next->missed++;
+      }
+      next->due = now + next->period;
+   } else {
+      next->due += next->period;
+   }
+
+   uint32_t startTime = micros();
+   next->run();
+   uint32_t elapsed = micros() - startTime;
+
+   next->busy += elapsed;
+   next->runs++;
+   if(elapsed > next->wcet) {
+      next->wcet = elapsed;
+   }
+   return true;
+}
+
+//************************************************************************************
+// One line per task: name, period, runs, share of the interval, WCET and missed deadlines.
+// Runs and the time share cover the interval since the last report, WCET and misses
+// are since power on.
+//************************************************************************************
+void Scheduler::report(Print &out) {
+   uint32_t now = micros();
+   uint32_t interval = now - intervalStart;
+   uint32_t total = 0;
+
+   out.println(F("task      ms  runs  load%  wcet_us  missed"));
+   for(uint8_t i = 0; i < numTasks; i++) {
+      SchedulerTask &t = tasks[i];
+      out.print(t.name);
+      out.print(F("  "));
+      out.print(t.period);
+      out.print(F("  "));
+      out.print(t.runs);
+      out.print(F("  "));
+      printTenths(out, t.busy, interval);
+      out.print(F("  "));
+      out.print(t.wcet);
+      out.print(F("  "));
+      out.println(t.missed);
+      total += t.busy;
+      t.busy = 0;
+      t.runs = 0;
+   }
+   out.print(F("busy% "));
+   printTenths(out, total, interval);
+   out.println();
+   intervalStart = now;
+}
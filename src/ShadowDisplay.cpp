@@ -0,0 +1,320 @@
+/*******************************************************************************************************
+Character-cell shadow of the OLED.  See ShadowDisplay.h.
+*******************************************************************************************************/
+#include "ShadowDisplay.h"
+
+const uint8_t DISPLAY_WIDTH = 128;
+const uint8_t DISPLAY_PAGES = 8;
+const uint8_t CHAR_WIDTH = 6;           // System5x7 plus a pixel of letter spacing (see Hal.cpp)
+const uint8_t CELL_WIDTH = 2 * CHAR_WIDTH;
+const uint8_t EDGE_COL = SHADOW_COLS - 1;   // The strip right of the last whole 2X character
+const char BLANK = ' ';
+const char UNTRACKED = 1;               // 1X or off-grid text we didn't keep
+const uint8_t UNKNOWN = 0xFF;
+const uint8_t CELL_BYTES = 6;           // Queue bytes a cell can take: size, cursor move and the character
+const uint8_t EDGE_BLANK_BYTES = 9;     // Blanking the edge strip of a row: size, then a cursor move and clear for each page
+
+static uint8_t gridCol(uint8_t col) {
+   return col / CELL_WIDTH < EDGE_COL ? col / CELL_WIDTH : EDGE_COL;
+}
+
+ShadowDisplay::ShadowDisplay(DisplayQueue &panel) : panel(panel) {
+   memset(cells, BLANK, sizeof(cells));
+   memset(touched, 0xFF, sizeof(touched));
+   memset(waiting, 0, sizeof(waiting));
+   frames = 0;
+   dropped = 0;
+   pending = false;
+   cutShort = false;
+   col = 0;
+   row = 0;
+   magnify = 1;
+   panelCol = UNKNOWN;
+   panelRow = UNKNOWN;
+   panelMagnify = UNKNOWN;
+}
+
+void ShadowDisplay::begin() {
+   panel.begin();   // Comes up blank, same as the grid
+}
+
+void ShadowDisplay::clear() {
+   memset(touched, 0, sizeof(touched));
+   frames++;
+   pending = true;
+   cutShort = false;
+   col = 0;
+   row = 0;
+}
+
+void ShadowDisplay::resume() {
+   cutShort = false;
+}
+
+void ShadowDisplay::set1X() {
+   magnify = 1;
+}
+
+void ShadowDisplay::set2X() {
+   magnify = 2;
+}
+
+void ShadowDisplay::setCursor(uint8_t col, uint8_t row) {
+   this->col = col;
+   this->row = row;
+}
+
+uint8_t ShadowDisplay::fieldWidth(uint8_t n) {
+   return n * CHAR_WIDTH * magnify;
+}
+
+// The queue turned something away.  If it was part of a frame, the frame isn't finished.
+bool ShadowDisplay::drop() {
+   dropped++;
+   if(pending) {
+      cutShort = true;
+   }
+   return false;
+}
+
+void ShadowDisplay::setCell(uint8_t gridRow, uint8_t gridCol, char c) {
+   cells[gridRow][gridCol] = c;
+   waiting[gridRow] |= 1 << gridCol;
+}
+
+//************************************************************************************
+// Blanking a field on the grid waits for flush(), so whatever gets written back over it
+// first costs nothing.  Anything else is queued for the panel straight away.
+//************************************************************************************
+void ShadowDisplay::clearField(uint8_t col, uint8_t row, uint8_t n) {
+   setCursor(col, row);
+   if(magnify == 2 && col % CELL_WIDTH == 0 && row % 2 == 0) {
+      uint16_t end = col + (uint16_t)fieldWidth(n);
+      for(uint8_t c = col / CELL_WIDTH; c < SHADOW_COLS && c * CELL_WIDTH < end; c++) {
+         touched[row / 2] &= ~(1 << c);
+      }
+      pending = true;
+   } else if(claimCells(col, row, fieldWidth(n), magnify, false) && usePanelSize(magnify) &&
+             panel.clearField(col, row, n)) {
+      panelCol = UNKNOWN;   // The queue may leave the cursor anywhere in the field
+   } else {
+      drop();
+   }
+}
+
+void ShadowDisplay::clearToEOL() {
+   clearField(col, row, (DISPLAY_WIDTH - col + fieldWidth(1) - 1) / fieldWidth(1));
+}
+
+//************************************************************************************
+// Characters on the grid only go in their cell, to be sent by service() if that's a
+// change.  Anything else is queued now, and returns 0 if there wasn't room.
+//************************************************************************************
+size_t ShadowDisplay::write(uint8_t c) {
+   if(c == '\r') {
+      return 1;
+   }
+   if(c == '\n') {
+      col = 0;
+      row += magnify;
+      return 1;
+   }
+   uint8_t width = fieldWidth(1);
+   if(row + magnify > DISPLAY_PAGES || col + width > DISPLAY_WIDTH) {
+      return 1;   // Off the edge, the library drops it too
+   }
+   size_t written = 1;
+   if(magnify == 2 && col % CELL_WIDTH == 0 && row % 2 == 0) {
+      touch(row / 2, col / CELL_WIDTH);
+      if(cells[row / 2][col / CELL_WIDTH] != (char)c) {
+         setCell(row / 2, col / CELL_WIDTH, c);
+      }
+   } else if(!claimCells(col, row, width, magnify, true) || !send(c, col, row, magnify)) {
+      written = drop();
+   }
+   col += width;
+   return written;
+}
+
+#ifdef BIG_DIGITS
+//************************************************************************************
+// A big digit at the cursor, drawn over the one that's there (see BigDigits.h).  It's
+// off the grid, so its cells are claimed the same as 1X text.
+//************************************************************************************
+bool ShadowDisplay::writeBig(uint8_t glyph, uint8_t oldGlyph) {
+   if(row + BIG_DIGIT_PAGES > DISPLAY_PAGES || col + BIG_DIGIT_WIDTH > DISPLAY_WIDTH) {
+      return true;
+   }
+   bool sent = claimCells(col, row, BIG_DIGIT_WIDTH, BIG_DIGIT_PAGES, true) && panel.writeBig(col, row, glyph, oldGlyph);
+   panelCol = UNKNOWN;
+   col += BIG_DIGIT_WIDTH;
+   return sent || drop();
+}
+#endif
+
+//************************************************************************************
+// Queue one character, moving the panel's cursor only if it isn't there.
+//************************************************************************************
+bool ShadowDisplay::send(uint8_t c, uint8_t col, uint8_t row, uint8_t size) {
+   if(!usePanelSize(size)) {
+      return false;
+   }
+   if(panelCol != col || panelRow != row) {
+      if(!panel.setCursor(col, row)) {
+         return false;
+      }
+      panelCol = col;
+      panelRow = row;
+   }
+   if(!panel.write(c)) {
+      return false;
+   }
+   panelCol = col + CHAR_WIDTH * size;
+   return true;
+}
+
+bool ShadowDisplay::usePanelSize(uint8_t size) {
+   if(panelMagnify != size) {
+      if(!(size == 2 ? panel.set2X() : panel.set1X())) {
+         return false;
+      }
+      panelMagnify = size;
+   }
+   return true;
+}
+
+//************************************************************************************
+// Something we don't keep is about to go on the panel over these pixels.  Cells with
+// leftovers from the last frame, or a change that hasn't gone yet, are blanked first (a
+// run at a time) so the rest of them doesn't stay up, then they're all marked as
+// holding untracked text.  False if the queue hadn't room for the blanking.
+//************************************************************************************
+bool ShadowDisplay::claimCells(uint8_t col, uint8_t row, uint8_t width, uint8_t pages, bool written) {
+   uint8_t first = gridCol(col);
+   uint8_t last = gridCol(col + width - 1);
+   uint8_t lastPage = row + pages - 1 < DISPLAY_PAGES ? row + pages - 1 : DISPLAY_PAGES - 1;
+   for(uint8_t r = row / 2; r <= lastPage / 2; r++) {
+      uint8_t runStart = 0;
+      uint8_t runLength = 0;
+      for(uint8_t c = first; c <= last + 1; c++) {
+         if(c <= last && (isWaiting(r, c) || (!isTouched(r, c) && cells[r][c] != BLANK))) {
+            if(runLength == 0) {
+               runStart = c;
+            }
+            runLength++;
+         } else if(runLength) {
+            if(!blankCells(r, runStart, runLength)) {
+               return false;
+            }
+            runLength = 0;
+         }
+      }
+      for(uint8_t c = first; c <= last; c++) {
+         if(written || cells[r][c] != BLANK) {
+            cells[r][c] = UNTRACKED;
+         }
+         if(written) {
+            touch(r, c);
+         }
+      }
+   }
+   return true;
+}
+
+//************************************************************************************
+// Queue the blanking of n cells of a grid row, the right edge strip included if the
+// run reaches it.  False if the queue hadn't room.
+//************************************************************************************
+bool ShadowDisplay::blankCells(uint8_t gridRow, uint8_t first, uint8_t n) {
+   uint8_t last = first + n - 1;
+   panelCol = UNKNOWN;
+   panelMagnify = UNKNOWN;
+   if(first < EDGE_COL) {
+      if(!panel.set2X() || !panel.clearField(first * CELL_WIDTH, gridRow * 2, (last < EDGE_COL ? last : EDGE_COL - 1) - first + 1)) {
+         return false;
+      }
+   }
+   if(last == EDGE_COL) {
+      if(!panel.set1X()) {
+         return false;
+      }
+      for(uint8_t page = gridRow * 2; page < gridRow * 2 + 2; page++) {
+         if(!panel.setCursor(EDGE_COL * CELL_WIDTH, page) || !panel.clearToEOL()) {
+            return false;
+         }
+      }
+   }
+   for(uint8_t c = first; c <= last; c++) {
+      cells[gridRow][c] = BLANK;
+      waiting[gridRow] &= ~(1 << c);
+   }
+   return true;
+}
+
+//************************************************************************************
+// End of the frame.  Mark the cells with something on them that nobody wrote to be
+// blanked.  A frame that was cut short isn't finished yet, so nothing's blanked until
+// whoever drew it has drawn the rest.
+//************************************************************************************
+void ShadowDisplay::flush() {
+   if(!pending || cutShort) {
+      return;
+   }
+   for(uint8_t r = 0; r < SHADOW_ROWS; r++) {
+      for(uint8_t c = 0; c < SHADOW_COLS; c++) {
+         if(!isTouched(r, c) && cells[r][c] != BLANK) {
+            setCell(r, c, BLANK);
+         }
+      }
+      touched[r] = 0xFFFF;
+   }
+   pending = false;
+}
+
+//************************************************************************************
+// Put the cells waiting to be sent into the queue, in order along each row so a run of
+// them costs one cursor move, for as long as there's room.  Only blanks wait in the
+// edge strip, nothing on the grid is written there.
+//************************************************************************************
+void ShadowDisplay::sendWaiting() {
+   for(uint8_t r = 0; r < SHADOW_ROWS; r++) {
+      for(uint8_t c = 0; waiting[r] && c < SHADOW_COLS; c++) {
+         if(!isWaiting(r, c)) {
+            continue;
+         }
+         if(c == EDGE_COL) {
+            if(panel.room() < EDGE_BLANK_BYTES || !blankCells(r, c, 1)) {
+               return;
+            }
+         } else {
+            if(panel.room() < CELL_BYTES || !send(cells[r][c], c * CELL_WIDTH, r * 2, 2)) {
+               return;
+            }
+            waiting[r] &= ~(1 << c);
+         }
+      }
+   }
+}
+
+bool ShadowDisplay::service(uint16_t budgetUs) {
+   sendWaiting();
+   bool more = panel.service(budgetUs);
+   sendWaiting();   // Into the room that slice made, for the next one
+   return more || anyWaiting();
+}
+
+void ShadowDisplay::drain() {
+   do {
+      sendWaiting();
+      panel.drain();
+   } while(anyWaiting());
+}
+
+bool ShadowDisplay::anyWaiting() {
+   for(uint8_t r = 0; r < SHADOW_ROWS; r++) {
+      if(waiting[r]) {
+         return true;
+      }
+   }
+   return false;
+}
@@ -0,0 +1,157 @@
+/*******************************************************************************************************
+Stability detector.  See Stability.h for the overview.
+*******************************************************************************************************/
+#include "Stability.h"
+
+const uint32_t STABLE_BLOCK_MS = STABLE_WINDOW_MS / STABLE_BLOCKS;
+const q16_t STABLE_ENTER_Q16 = (q16_t)(((int32_t)STABLE_ENTER_CENTI << Q16_SHIFT) / 100);
+const q16_t STABLE_EXIT_Q16 = (q16_t)(((int32_t)STABLE_EXIT_CENTI << Q16_SHIFT) / 100);
+const int32_t STABLE_MAX_OFFSET = (int32_t)64 << Q16_SHIFT;
+
+StabilityDetector::StabilityDetector() {
+   reset();
+}
+
+void StabilityDetector::reset() {
+   clearWindow();
+   started = false;
+   stable = false;
+   stableLevel = 0;
+}
+
+// Just the readings, not what's been decided from them
+void StabilityDetector::clearWindow() {
+   for(uint8_t i = 0; i < STABLE_BLOCKS; i++) {
+      clearBlock(blocks[i]);
+   }
+   current = 0;
+   blocksFilled = 0;
+}
+
+void StabilityDetector::clearBlock(Block &block) {
+   block.minVal = 0;
+   block.maxVal = 0;
+   block.sum = 0;
+   block.count = 0;
+}
+
+//************************************************************************************
+// Close the current block and reuse the oldest one
+//************************************************************************************
+void StabilityDetector::advanceBlock() {
+   current = (current + 1) % STABLE_BLOCKS;
+   clearBlock(blocks[current]);
+   blockStart += STABLE_BLOCK_MS;
+   if(blocksFilled < STABLE_BLOCKS) {
+      blocksFilled++;
+   }
+}
+
+//************************************************************************************
+// Add one reading and re-judge stability.  Returns the state change, if any.
+//************************************************************************************
+StabilityEvent StabilityDetector::update(q16_t value, uint32_t now) {
+   if(!started) {
+      reference = value;
+      blockStart = now;
+      started = true;
+   }
+
+   // Catch up on any blocks whose time has passed.  After a gap longer than the whole
+   // window nothing in it is current any more, so start the window over.  Whether it's
+   // stable, and the level it settled at, stay for the new window to judge: a gap on
+   // its own is no reason to say the weight moved.
+   if(now - blockStart >= STABLE_WINDOW_MS) {
+      clearWindow();
+      reference = value;
+      blockStart = now;
+   }
+   bool blockClosed = false;
+   while(now - blockStart >= STABLE_BLOCK_MS) {
+      advanceBlock();
+      blockClosed = true;
+   }
+
+   Block &block = blocks[current];
+   int32_t offset = value - reference;
+   if(offset > STABLE_MAX_OFFSET) {
+      offset = STABLE_MAX_OFFSET;
+   } else if(offset < -STABLE_MAX_OFFSET) {
+      offset = -STABLE_MAX_OFFSET;
+   }
+   if(block.count == 0 || value < block.minVal) {
+      block.minVal = value;
+   }
+   if(block.count == 0 || value > block.maxVal) {
+      block.maxVal = value;
+   }
+   if(block.count < 255) {
+      block.sum += offset;
+      block.count++;
+   }
+
+   // Hysteresis: a tighter limit to become stable than to stay stable
+   q16_t spread = peakToPeak();
+   if(!stable && isWindowFull() && spread <= STABLE_ENTER_Q16) {
+      stable = true;
+      stableLevel = mean();
+      return STABILITY_BECAME_STABLE;
+   }
+   if(stable && (spread > STABLE_EXIT_Q16 || (blockClosed && hasDrifted()))) {
+      stable = false;
+      return STABILITY_BECAME_UNSTABLE;
+   }
+   return STABILITY_NO_CHANGE;
+}
+
+//************************************************************************************
+// A slow creep keeps the peak-to-peak inside the window small, so on its own it would
+// never end a stable reading.  The window's mean moving further than the exit limit
+// from where it was when it became stable ends it too.  Checked as each block closes,
+// which is often enough and keeps the divide out of every sample.
+//************************************************************************************
+bool StabilityDetector::hasDrifted() const {
+   q16_t drift = mean() - stableLevel;
+   return drift > STABLE_EXIT_Q16 || drift < -STABLE_EXIT_Q16;
+}
+
+q16_t StabilityDetector::peakToPeak() const {
+   bool any = false;
+   q16_t lo = 0;
+   q16_t hi = 0;
+   for(uint8_t i = 0; i < STABLE_BLOCKS; i++) {
+      const Block &block = blocks[i];
+      if(block.count == 0) {
+         continue;
+      }
+      if(!any || block.minVal < lo) {
+         lo = block.minVal;
+      }
+      if(!any || block.maxVal > hi) {
+         hi = block.maxVal;
+      }
+      any = true;
+   }
+   return hi - lo;
+}
+
+uint16_t StabilityDetector::sampleCount() const {
+   uint16_t n = 0;
+   for(uint8_t i = 0; i < STABLE_BLOCKS; i++) {
+      n += blocks[i].count;
+   }
+   return n;
+}
+
+q16_t StabilityDetector::mean() const {
+   int64_t sum = 0;
+   uint16_t n = 0;
+   for(uint8_t i = 0; i < STABLE_BLOCKS; i++) {
+      sum += blocks[i].sum;
+      n += blocks[i].count;
+   }
+   if(n == 0) {
+      return reference;
+   }
+   return reference + (q16_t)(sum / n);
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************************************
+The calibration constant and the stored weights, kept in EEPROM as a log.  See ValueLog.h.
+*******************************************************************************************************/
+#include <string.h>
+#include "ValueLog.h"
+#include "Hal.h"
+
+static_assert(sizeof(LogRecord) == 8, "A log record is 8 bytes on the Nano and the native build alike");
+static_assert(LOG_KEYS <= 16, "Keys are 4 bits of the tag");
+static_assert(LOG_START >= LOG_LAPS * 4, "The log mustn't overwrite the old layout");
+
+const uint8_t NO_SLOT = 0xFF;
+const uint8_t NO_KEY = 0xFF;
+const uint16_t SEQ_MASK = 0x0FFF;
+const uint8_t KEY_MASK = 0x0F;
+const uint8_t CRC_BYTES = sizeof(LogRecord) - sizeof(uint16_t);   // Value and tag
+
+uint8_t ValueLog::latest[LOG_KEYS];
+uint8_t ValueLog::head;
+uint16_t ValueLog::nextSeq;
+uint16_t ValueLog::written;
+uint16_t ValueLog::skipped;
+
+// CRC-16/CCITT (polynomial 0x1021, starting at 0xFFFF).  A blank slot, all 0xFF, doesn't check.
+static uint16_t crc16(const void *data, uint8_t len) {
+   const uint8_t *p = (const uint8_t *)data;
+   uint16_t crc = 0xFFFF;
+   while(len--) {
+      crc ^= (uint16_t)*p++ << 8;
+      for(uint8_t i = 0; i < 8; i++) {
+         crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+   }
+   return crc;
+}
+
+static int slotAddress(uint8_t slot) {
+   return LOG_START + slot * sizeof(LogRecord);
+}
+
+static uint8_t nextSlot(uint8_t slot) {
+   return slot + 1 < LOG_SLOTS ? slot + 1 : 0;
+}
+
+static bool readRecord(uint8_t slot, LogRecord &record) {
+   ScaleStorage::read(slotAddress(slot), &record, sizeof(record));
+   return (record.tag & KEY_MASK) < LOG_KEYS && record.crc == crc16(&record, CRC_BYTES);
+}
+
+// a was written after b.  Sequence numbers go round at 4096, and the log only ever
+// holds the last LOG_SLOTS of them.
+static bool newer(uint16_t a, uint16_t b) {
+   uint16_t ahead = (a - b) & SEQ_MASK;
+   return ahead != 0 && ahead < (SEQ_MASK + 1) / 2;
+}
+
+//************************************************************************************
+// Read every slot once and keep the latest record of each key.  The next record goes
+// after the latest of all of them.
+//************************************************************************************
+void ValueLog::begin() {
+   uint16_t latestSeq[LOG_KEYS];
+   uint8_t newestSlot = NO_SLOT;
+   uint16_t newestSeq = 0;
+
+   memset(latest, NO_SLOT, sizeof(latest));
+   for(uint8_t slot = 0; slot < LOG_SLOTS; slot++) {
+      LogRecord record;
+      if(!readRecord(slot, record)) {
+         continue;   // Blank, or never finished
+      }
+      uint8_t key = record.tag & KEY_MASK;
+      uint16_t seq = record.tag >> 4;
+      if(latest[key] == NO_SLOT || newer(seq, latestSeq[key])) {
+         latest[key] = slot;
+         latestSeq[key] = seq;
+      }
+      if(newestSlot == NO_SLOT || newer(seq, newestSeq)) {
+         newestSlot = slot;
+         newestSeq = seq;
+      }
+   }
+
+   if(newestSlot == NO_SLOT) {
+      head = 0;      // A new log
+      nextSeq = 0;
+   } else {
+      head = nextSlot(newestSlot);
+      nextSeq = (newestSeq + 1) & SEQ_MASK;
+   }
+}
+
+//************************************************************************************
+// The latest value of key.  One that's never been written to the log is still where
+// the old layout kept it (blank EEPROM reads as a NaN float, as it always did).
+//************************************************************************************
+uint32_t ValueLog::read(uint8_t key) {
+   uint32_t value = 0;
+   if(latest[key] != NO_SLOT) {
+      ScaleStorage::read(slotAddress(latest[key]), &value, sizeof(value));   // value is first in the record
+   } else if(key < LOG_LAPS) {
+      ScaleStorage::read(key * sizeof(uint32_t), &value, sizeof(value));
+   }
+   return value;
+}
+
+bool ValueLog::write(uint8_t key, uint32_t value) {
+   if(read(key) == value) {
+      skipped++;
+      return false;
+   }
+   uint8_t before = head;
+   append(key, value);
+   if(head < before) {   // Went round
+      append(LOG_LAPS, read(LOG_LAPS) + 1);
+   }
+   return true;
+}
+
+//************************************************************************************
+// Add a record at the head.  The slot after it is the next one written over, so if
+// that's still the latest of another key, that key's value is copied to the head
+// first.  Power can go at any point here and every key still has a record that
+// checks: its old one is only written over once the copy is down.
+//************************************************************************************
+void ValueLog::append(uint8_t key, uint32_t value) {
+   uint8_t ahead;
+   while((ahead = keyAt(nextSlot(head))) != NO_KEY && ahead != key) {
+      writeRecord(ahead, read(ahead));
+   }
+   writeRecord(key, value);
+}
+
+void ValueLog::writeRecord(uint8_t key, uint32_t value) {
+   LogRecord record;
+   record.value = value;
+   record.tag = nextSeq << 4 | key;
+   record.crc = crc16(&record, CRC_BYTES);
+   ScaleStorage::write(slotAddress(head), &record, sizeof(record));
+
+   latest[key] = head;
+   head = nextSlot(head);
+   nextSeq = (nextSeq + 1) & SEQ_MASK;
+   written++;
+}
+
+// The key whose latest record is in slot, NO_KEY if it's garbage
+uint8_t ValueLog::keyAt(uint8_t slot) {
+   for(uint8_t key = 0; key < LOG_KEYS; key++) {
+      if(latest[key] == slot) {
+         return key;
+      }
+   }
+   return NO_KEY;
+}
+
+//************************************************************************************
+// One line for the serial port:
+//    eeprom log: 122 slots, 3 laps (wear per cell), next slot 45, 17 written, 4 unchanged
+//************************************************************************************
+void ValueLog::report(Print &out) {
+   out.print(F("eeprom log: "));
+   out.print(LOG_SLOTS);
+   out.print(F(" slots, "));
+   out.print(read(LOG_LAPS));
+   out.print(F(" laps (wear per cell), next slot "));
+   out.print(head);
+   out.print(F(", "));
+   out.print(written);
+   out.print(F(" written, "));
+   out.print(skipped);
+   out.println(F(" unchanged"));
+}
@@ -0,0 +1,116 @@
+/*******************************************************************************************************
+Fixed-point weight math.  See WeightMath.h for the overview.
+*******************************************************************************************************/
+#include "WeightMath.h"
+
+//************************************************************************************
+// Work out the reciprocal of the calibration factor.  Only done when the cal changes.
+// We want pounds(Q16.16) = netCounts * 100 * 2^16 / calCenti.  Start with as many
+// fraction bits as 64 bits allow, then drop bits until the reciprocal fits in 31 so
+// netCounts (24 bits) * recip always fits in an int64.
+//************************************************************************************
+void setWeightScale(WeightScale &scale, int32_t calCenti) {
+   if(calCenti == 0) {
+      scale.recip = 0;
+      scale.shift = 0;
+      return;
+   }
+   bool negative = calCenti < 0;
+   uint32_t cal = negative ? -(uint32_t)calCenti : (uint32_t)calCenti;
+   uint8_t shift = 40;
+   uint64_t recip = ((uint64_t)100 << (Q16_SHIFT + shift)) / cal;
+   while(recip > 0x7FFFFFFFUL && shift > 0) {
+      recip >>= 1;
+      shift--;
+   }
+   scale.recip = negative ? -(int32_t)recip : (int32_t)recip;
+   scale.shift = shift;
+}
+
+//************************************************************************************
+// A small or zero cal factor (a corrupted EEPROM, or the 1.00 calibration runs with)
+// makes pounds too big for Q16.16.  Those are pinned at the end of the range rather
+// than wrapped, so full-scale counts never come out as a small or negative weight.
+//************************************************************************************
+q16_t countsToPounds(int32_t netCounts, const WeightScale &scale) {
+   int64_t pounds = (int64_t)netCounts * scale.recip;
+   if(scale.shift > 0) {
+      pounds = (pounds + ((int64_t)1 << (scale.shift - 1))) >> scale.shift;
+   }
+   if(pounds > 0x7FFFFFFFL) {
+      return 0x7FFFFFFFL;
+   }
+   if(pounds < -0x7FFFFFFFL - 1) {
+      return -0x7FFFFFFFL - 1;
+   }
+   return (q16_t)pounds;
+}
+
+q16_t poundsToKilogramsQ16(q16_t pounds) {
+   return (q16_t)(((int64_t)pounds * LB_TO_KG_Q30 + ((int64_t)1 << 29)) >> 30);
+}
+
+// In 64 bits, since value * 100 overflows 32 past 327 lb
+int32_t q16ToCenti(q16_t value) {
+   return (int32_t)(((int64_t)value * 100 + (Q16_ONE >> 1)) >> Q16_SHIFT);
+}
+
+//************************************************************************************
+// Calibration factor (counts per pound, in hundredths) from the net counts measured
+// with a known reference weight (pounds, in hundredths) on the scale
+//************************************************************************************
+int32_t calFromReference(int32_t netCounts, int32_t refCenti) {
+   if(refCenti == 0) {
+      return 0;
+   }
+   return (int32_t)((int64_t)netCounts * 10000 / refCenti);
+}
+
+//************************************************************************************
+// Decode an IEEE-754 single into hundredths, rounded.  Blank EEPROM (NaN) reads as 0.
+// Anything past +/-21474836.47 (a corrupted value) is clamped there rather than wrapped.
+//************************************************************************************
+int32_t centiFromFloatBits(uint32_t bits) {
+   int16_t exponent = (bits >> 23) & 0xFF;
+   if(exponent == 0 || exponent == 0xFF) {
+      return 0;   // Zero, denormals (far below a hundredth), infinity and NaN
+   }
+   uint32_t mantissa = (bits & 0x7FFFFFUL) | 0x800000UL;
+   uint32_t scaled = mantissa * 100;          // Fits: 2^24 * 100 < 2^31
+   int16_t shift = exponent - 150;            // value = mantissa * 2^(exponent - 127 - 23)
+   uint32_t centi;
+   if(shift >= 0) {
+      centi = (shift > 7 || scaled > (0x7FFFFFFFUL >> shift)) ? 0x7FFFFFFFUL : scaled << shift;
+   } else if(shift < -31) {
+      centi = 0;
+   } else {
+      centi = (scaled + ((uint32_t)1 << (-shift - 1))) >> -shift;
+   }
+   return (bits & 0x80000000UL) ? -(int32_t)centi : (int32_t)centi;
+}
+
+//************************************************************************************
+// Encode hundredths as the nearest IEEE-754 single
+//************************************************************************************
+uint32_t floatBitsFromCenti(int32_t centi) {
+   if(centi == 0) {
+      return 0;
+   }
+   uint32_t sign = centi < 0 ? 0x80000000UL : 0;
+   uint32_t magnitude = centi < 0 ? -(uint32_t)centi : (uint32_t)centi;
+
+   // value * 2^32, which always has at least 25 significant bits for magnitude >= 1
+   uint64_t q = ((uint64_t)magnitude << 32) / 100;
+   int8_t top = 63;
+   while(!(q & ((uint64_t)1 << top))) {
+      top--;
+   }
+   uint8_t drop = top - 23;
+   uint32_t mantissa = (uint32_t)((q + ((uint64_t)1 << (drop - 1))) >> drop);
+   if(mantissa & 0x1000000UL) {   // Rounding carried into a new bit
+      mantissa >>= 1;
+      top++;
+   }
+   uint32_t exponent = top - 32 + 127;
+   return sign | (exponent << 23) | (mantissa & 0x7FFFFFUL);
+}
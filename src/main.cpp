@@ -21,7 +21,7 @@ To calibrate:
 You can also manually adjust the calVal by clicking on "Edit Cal".  Dial in the number you want then
 click on "Save Cal" to store it in EEPROM.
 
-Scale readings can be stored in eight memory locations (M0-M7).  
+Scale readings can be stored in ten memory locations (M0-M9).  
 - To store a value, go to the Memory menu,
   move the cursor to the location you want to store at then click the rotary switch.  Confirm you want to
   store by double-clicking.  If you single-click you will abort the store. 
@@ -36,194 +36,448 @@ Jeff's and the KITTY_SCALE use the wire library to implement I2C interface.  The
 
 Using a rotary encoder with click-switch to implement a simple menu system to allow
 things like storing/recalling measurments, re-zeroing the scale, re-calibrating, etc.
-Currently a max of 8 rows per menu is allowed.  Clicking pushes into a menu/item.  
+Menus can have any number of items; the display shows four at a time and scrolls.  Clicking pushes into a menu/item.  
 Double-clicking returns to the parent menu.  Rotating the knob scrolls through the 
 menu items.  Library at: https://github.com/0xPIT/encoder
 
 Uses HX711 ADC library to drive the load-cell ADC/amplifier
 https://github.com/olkal/HX711_ADC
 
+The build variant (Jeff's, KITTY_SCALE or FIVE_KG_SCALE) is picked by the platformio.ini environment,
+and what's different about each one (pins, display, HX711 rate, range) is in its traits in
+include/Board.h.  The other build switches shared with the other source files (acquisition mode,
+float vs. fixed-point math, etc.) are in include/ScaleConfig.h.
+
+In HIGH_RATE_MODE every HX711 conversion is used rather than one per readInterval.  The conversions
+feed the stability detector at full rate, are averaged down (decimated) to the display rate, and
+are handed to any registered sample consumers (peak capture, serial streaming).  Each board's
+HX711_SPS (Board.h) is the rate its RATE pin is strapped for.
+
+With HX711_ISR_MODE defined, the HX711 is read from a pin-change interrupt on DOUT instead of being
+polled from loop().  Every conversion goes into a ring buffer that the main loop drains, so nothing
+is lost while the UI is busy.  Conversions dropped because the ring was full are counted and
+reported on the serial port.
+
+A stability detector (see Stability.h) watches the weight over a time window.  Once it settles the
+display holds the settled value and shows "STABLE", and stable/moving events go out on the serial
+port.  Storing to a memory waits for the weight to be stable (STORE_WAIT_FOR_STABLE).
+
+Re-zeroing and calibration are state machines that loop() steps through rather than functions that
+block until they're done.  The scale keeps measuring while they run, they show their progress on
+the OLED, finish as soon as enough fresh samples are in, and a double-click cancels them.
+
+All of the hardware is reached through the thin interfaces in Hal.h (display, knob, timer,
+storage) and the HX711 sample source in Hx711Isr.h.  The [env:native] build links the same code
+against simulated devices (lib/NativeSim) so the menus and the measurement pipeline can be run,
+benchmarked and regression-tested on a PC.
+
+With RAW_TRACE defined, sending 't' on the serial port starts (and stops) streaming every raw HX711
+conversion with its timestamp.  The native build can replay such a trace through this same code
+to measure settling, noise and display updates offline (see lib/NativeSim/src/Replay.cpp).
+
+loop() only runs the task scheduler (see Scheduler.h).  Acquisition, the knob, menu and weight
+rendering and the battery check are tasks with their own periods and priorities, and each one's
+worst-case run time and missed deadlines are kept.  SCHEDULER_REPORT prints them periodically.
+
+The weight math runs in fixed point (see WeightMath.h) from the raw HX711 counts to the x.yy digits
+on the display, so the Nano doesn't spend its time in soft-float routines.  FLOAT_WEIGHT_MATH
+brings back the original float math.
+
+The weight screen draws its labels once and then only rewrites the digits that changed (see
+DisplayField.h), so it no longer flashes on every new reading.
+
+All drawing goes through a character-cell shadow of the panel (ShadowDisplay.h).  Screens still
+clear and redraw themselves, but only the cells that end up different are sent to the OLED.
+The shadow doesn't talk to the panel itself: the cells that changed wait in its grid, anything
+else is queued (DisplayQueue.h), and the display task sends them a slice at a time, at most
+DISPLAY_SLICE_US per slice, so a redraw never holds up the load cell or the knob.  Nothing waits
+for the bus when the queue is full.  What didn't fit is drawn on a later pass (ShadowDisplay::drops(),
+displayMenu() picks up at the row it stopped on).  'd' on the serial port reports the worst slice,
+the deepest queue and how often it was full.
+
+Underneath, the panel is driven through our own SPI/I2C code (OledBus.h) rather than the library's,
+with FAST_OLED_BUS.  With DISPLAY_BENCHMARK, "Benchmark" at the end of the first menu times a full
+screen and a single weight field on each bus setting, to pick OLED_SPI_HZ/OLED_I2C_HZ by.  Until
+that's been run on a scale they're the library's own clocks.
+
+With BIG_DIGITS the weights are drawn in a larger seven-segment font kept in flash (BigDigits.h),
+3X or 4X the 8-pixel rows.  Only the columns of a digit that change are sent, so a reading that
+moves by a count or two costs a few dozen bytes on the bus instead of a whole 2X field.
+
+With ADAPTIVE_REFRESH the weight screen isn't checked on a fixed 200 ms any more: every
+REFRESH_MOVING_MS while the weight is moving, REFRESH_STABLE_MS once it's stable, and
+REFRESH_IDLE_MS with the panel dimmed once nothing has changed for IDLE_AFTER_MS.  A new load,
+or the knob, brings it straight back to full speed and brightness.
+
+Turning the knob in a menu only moves the '>' from one row to the other (displayMenuCursor()).
+The whole menu is only drawn again for a new page or a new menu, or if something else has been
+on the screen since (ShadowDisplay::frame()).
+
+Each menu item has its own renderer (drawFuncPtr) that draws its title and any value that goes
+with it: the memory slots their weights, "Enter Ref" and "Edit Cal" the reference weight and
+calibration constant, and "Battery" the battery voltage.  A new item with a live value just
+needs a draw function, displayMenu() doesn't know about any of them.
+
+Menus can be any length.  The panel shows a window of four items that scrolls with the cursor,
+with a '^' or 'v' at the right when there's more above or below.  A menu of items that only
+differ by number (the memory slots) is a single entry with no title, see menuItemAt().
+
+The menu tables and their titles are in flash (Menu.h), none of it in RAM.  They're written as
+subMenu() and action() items, and makeMenu() works out each menu's item count and level when
+they're compiled, so there are no counts to keep in step by hand.  Only sub-menus go on the menu
+stack, so the actions don't move sp, and the stack is sized to the depth of the menu tree.
+
+Numbers go out through printFixed() (NumberFormat.h), which takes a whole number of hundredths
+(or tenths, or millivolts) and puts the decimal point in, with no floats or sprintf() and no
+divide of its own (the battery voltage is still cut down to hundredths or tenths with one before it
+goes in).  The weights are right-justified in their fields, so the digits don't shift when the
+sign comes and goes.
+
+With MEMORY_STATS, RAM is painted at power on so the stack's high water mark can be found later.
+'m' on the serial port, or "RAM" in the first menu, shows static, heap, stack and free RAM and
+the least there's been free (see MemoryStats.h).
+
+The calibration and the stored weights are kept in the EEPROM as a log of CRC-checked records
+(ValueLog.h) rather than at fixed addresses, so stores are spread over the whole EEPROM instead of
+wearing out the same few cells.  A value that hasn't changed isn't written again.  The latest of
+each is found once at power on, and 'e' on the serial port reports how worn the EEPROM is.
+
+With PROFILING defined, 'p' on the serial port prints call counts and min/avg/max times for the
+pieces of the hot path - the load cell update, weight and menu rendering, the battery read, the
+knob handling, the encoder's timer ISR and a whole loop() pass - then starts counting again (see
+Profiler.h).  Undefined, the counters compile away completely.
+
+RUN_BENCHMARKS, RAW_TRACE, DISPLAY_BENCHMARK, PROFILING and MEMORY_STATS are all off in
+ScaleConfig.h, so the scales only carry what they need.  Turn one on while working on the firmware.
+
 *******************************************************************************************************/
 #include <Arduino.h>
-#include <SPI.h>
-#include <Wire.h>
-#include "SSD1306Ascii.h"
-#include <HX711_ADC.h>
-#include <ClickEncoder.h>
-#include <TimerOne.h>
-#include <EEPROM.h>
+#include "ScaleConfig.h"
+#include "Board.h"
+#include "Hal.h"
+#include "WeightMath.h"
+#include "NumberFormat.h"
+#include "Menu.h"
+#include "Stability.h"
+#include "Benchmarks.h"
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "MemoryStats.h"
+#include "ValueLog.h"
+#include "DisplayQueue.h"
+#include "ShadowDisplay.h"
+#include "DisplayField.h"
+#include "BigDigits.h"
+
+ScaleDisplay panel;        // The OLED.  SPI or I2C, whatever Board::OLED_SPI says (see Hal.cpp)
+DisplayQueue displayQueue(panel);   // Sent a slice at a time by displayTask()
+ShadowDisplay oled(displayQueue);   // Everything draws through this, so only what changed goes to the panel
 
-//#define KITTY_SCALE   // Settings for the kitty scale version.  Comment both out for building Jeff's version
-#define FIVE_KG_SCALE   // Uncomment one or the other to build that version.  Don't uncomment both!
+// Size variables
+const int NUM_MEMORY_ENTRIES = 10; // Set up ten memory locations to store measurments (M0-M9, the labels are one digit)
+static_assert(NUM_MEMORY_ENTRIES == LOG_MEMORIES, "Each memory location needs its own key in the EEPROM log");
+
+#ifdef HIGH_RATE_MODE
+const uint8_t HIGH_RATE_DECIMATION = Board::HX711_SPS / 10;   // Conversions averaged into each display reading
+
+// Full-rate sample consumers.  Anything that wants every conversion (not just the
+// decimated display rate) registers a callback with addSampleConsumer().
+const uint8_t MAX_SAMPLE_CONSUMERS = 2;
+void (*sampleConsumers[MAX_SAMPLE_CONSUMERS])(weight_t weight, uint32_t time);
+uint8_t numSampleConsumers = 0;
+weight_t decimationSum = 0;    // Running sum of the conversions going into the next display reading
+uint8_t decimationCount = 0;
+#endif
 
-#ifdef FIVE_KG_SCALE
-#include "SSD1306AsciiSpi.h"
-SSD1306AsciiSpi oled; // Create an instance of the SPI OLED object
-#else
-#include "SSD1306AsciiAvrI2c.h"
-SSD1306AsciiAvrI2c oled;  // Create an instance of the OLED object
-#define I2C_ADDRESS 0x3c  // OLED address
+// Tare and calibration state machines.  loop() steps whichever one is running instead of
+// the menus, so the scale keeps measuring and the knob stays live while they wait on the
+// load cell.  A double-click cancels either one.
+enum TareState { TARE_IDLE, TARE_ZEROING };
+enum CalState { CAL_IDLE, CAL_WAIT_EMPTY, CAL_ZEROING, CAL_WAIT_REF, CAL_MEASURING, CAL_SHOW_RESULT };
+TareState tareState = TARE_IDLE;
+CalState calState = CAL_IDLE;
+decimal_t savedCalVal;             // Put back if the calibration is cancelled
+long savedTareOffset;              // Put back if a tare is cancelled
+unsigned long calResultTime;       // When the new calVal went up on the screen
+const unsigned long CAL_RESULT_TIME = 2000;  // How long it stays there unless they click
+const uint8_t NO_PROGRESS = 0xFF;
+uint8_t shownProgress = NO_PROGRESS;  // Last progress percentage drawn
+#ifndef HX711_ISR_MODE
+uint16_t dataSetCount = 0;         // Conversions since startDataSet()
+bool tareRestorePending = false;   // Cancelled tare still running in the library
 #endif
 
-// Size variables
-const int NUM_MEMORY_ENTRIES = 8;  // Set up eight memory locations to store measurments
+// Task scheduler that loop() runs.  Tasks are added in setup().
+Scheduler scheduler;
+const unsigned int ACQUISITION_PERIOD = 5;   // ms.  Well inside one HX711 conversion at 80 SPS.
+const unsigned int INPUT_PERIOD = 10;
+const unsigned int MENU_PERIOD = 20;
+const unsigned int SERIAL_PERIOD = 50;
+const unsigned int DISPLAY_PERIOD = 0;       // Whenever nothing more important is due
 
-// Rotary encode pins
-#ifdef KITTY_SCALE   // Wired my pins flipped, oops...
-const int ENC_A = 7;
-const int ENC_B = 6;
-const int ENC_SW = 8;
-#else
-const int ENC_A = 6;
-const int ENC_B = 7;
-const int ENC_SW = 8;
+#ifdef RAW_TRACE
+bool traceOn = false;          // Streaming raw HX711 conversions on the serial port
 #endif
 
 // Battery low variables
-const int BAT_PIN = A7;
 int low_battery_limit = 7000;  // Display low bat message if we drop below 7v (7000mv)
-unsigned long displayUpdateTimer = millis();
 boolean display_low_battery = false;
 int battery_voltage;
 
 // HX711 ADC/Amplifier pins and setup
 unsigned long adc_read_time = 0;
-const int readInterval = 100;  // Increase value (in ms) to slow down number of readings
-const int HX711_dout = 4;  //Arduino d4 pin for the data
-const int HX711_sck = 5;   //Arduino d5 pin for the clock
-HX711_ADC loadCell(HX711_dout, HX711_sck);
-
-// EEPROM addresses for the calibration value and weight storage
-const unsigned int calVal_eepromAdress = 0;
-int mem_eepromAddress[NUM_MEMORY_ENTRIES];
+const unsigned int readInterval = 100;  // Increase value (in ms) to slow down number of readings
+#ifdef HX711_ISR_MODE
+#include "IsrLoadCell.h"
+IsrLoadCell loadCell;      // On Board::HX711_DOUT and HX711_SCK
+#else
+#include <HX711_ADC.h>
+HX711_ADC loadCell(Board::HX711_DOUT, Board::HX711_SCK);
+#endif
 
 // Calibration constant for the load cell - Run the HX711 calibration sketch 
 // from the examples directory in Arduino IDE to get this number.  Reference weight is x.y lbs
 //float calVal = 47672.54;  
-float calVal;  
-
-// Values for weight measurment
-float pounds = 0.0;
-float kilograms = 0.0;
-float lastPounds = -1.0;       // Used for keeping previous measurment to see if measurment is stabilizing
-float lastKilograms = 0.0;     // Used for keeping previous measurment to see if measurment is stabilizing
-float storeArr[NUM_MEMORY_ENTRIES];   // memory storage for weight results
-float calRefWeight = 1.0;      // Weight (in pounds) used for calibration.  Initialize to one pound.
+decimal_t calVal;  
+
+// Values for weight measurment.  See WeightMath.h for the weight_t and decimal_t types.
+weight_t pounds = 0;           // Held at the settled value while the stability detector says stable
+weight_t kilograms = 0;
+StabilityDetector stability;   // Decides when the measurment has stabilized
+weight_t stablePounds = 0;     // Settled weight latched when the reading became stable
+weight_t peakPounds = 0;       // Heaviest reading since the last re-zero
+decimal_t shownPounds;         // What displayWeights() last put on the screen, so we only repaint on real changes
+decimal_t shownKilograms;
+bool shownStable;
+decimal_t storeArr[NUM_MEMORY_ENTRIES];   // memory storage for weight results (pounds)
+decimal_t calRefWeight = DECIMAL_ONE;     // Weight (in pounds) used for calibration.  Initialize to one pound.
 
 // OLED Display variables
-int DISPLAY_REFRESH_TIME =200; // Time (in ms) between results display update
+const unsigned int DISPLAY_REFRESH_TIME = 200; // Time (in ms) between results display update (battery, and the weights without ADAPTIVE_REFRESH)
+#ifdef ADAPTIVE_REFRESH
+// How often the weight screen is looked at, see setRefresh()
+enum RefreshLevel { REFRESH_MOVING, REFRESH_STABLE, REFRESH_IDLE };
+const uint16_t refreshPeriods[] = { REFRESH_MOVING_MS, REFRESH_STABLE_MS, REFRESH_IDLE_MS };
+RefreshLevel refreshLevel = REFRESH_MOVING;
+int8_t weightTaskId;
+uint32_t lastWeightChange;     // millis() when the weight screen last changed
+#endif
 uint8_t rowsPerChar;           // Number of rows per character (double when using 2X fonts)
 uint8_t col;                   // Column that the weight fields start at
 char padding[] = " ";          // Leading blanks to center the display
 bool dispUpdateNeeded = true;  // This is set true only when a display refresh is needed.  That way
                                // we can eliminate a flashing screen as you need to clear a line before writing it.
+const uint8_t STABLE_ROW = 6;  // 1X text row for the "STABLE" indicator on the weight screen
+const uint8_t BATTERY_ROW = 7; // 1X text row for the low battery warning
+
+// Weight screen fields.  The labels go up once when we enter L0, after that only the
+// characters of these fields that changed are sent to the panel.
+const uint8_t WEIGHT_FIELD_WIDTH = 6;   // "-12.34", with the "lbs"/"kg" label one blank after
+#ifdef BIG_DIGITS
+// The pounds in big digits (BigDigits.h).  At 3 pages the kilograms are big digits too,
+// at 4 there's only room for them in 2X text underneath.
+const uint8_t BIG_WEIGHT_SLOTS = 5;     // "-12.34", the point shares a slot
+#if BIG_DIGITS == 3
+const uint8_t BIG_WEIGHT_COL = 4;       // 80 pixels of digits, then the label in 2X
+const uint8_t KILOGRAMS_ROW = 3;
+#else
+const uint8_t BIG_WEIGHT_COL = 0;       // 105 pixels of digits, then the label in 1X
+const uint8_t KILOGRAMS_ROW = 4;
+#endif
+const uint8_t BIG_LABEL_COL = BIG_WEIGHT_COL + BIG_WEIGHT_SLOTS * BIG_DIGIT_WIDTH + 3;
+#endif
+DisplayField poundsField;
+DisplayField kilogramsField;
+DisplayField stableField;
+bool batteryWarningShown = false;       // Something on BATTERY_ROW that needs clearing
+bool weightsBehind = false;             // Some of the weight screen didn't fit in the display queue
+bool labelsBehind = false;              // Some of its labels didn't
   
 // Rotary Encoder setup
-ClickEncoder *encoder;         // Create an instance of the rotary encoder object
+ScaleKnob encoder;             // Create an instance of the rotary encoder object
 int last = 0;
 int value = 0;
 boolean buttonBeingHeld = false;  // Used to test if rotary button is being held down
 
 // Used by the encoder library to read encoder
 void timerIsr() {
-  encoder->service();
+  PROFILE_BEGIN(PROFILE_TIMER_ISR);
+  encoder.service();
+  PROFILE_END(PROFILE_TIMER_ISR);
 }
 
 // Menu/display state variables. 
 int cursorPosition = 0;        // Which menu row we are on
 
-// Create a stack to store the pointers to the current level menu structure array
-// We push the current menu level structure onto the stack each time we push into a sub-menu.
-// When returning from the sub-menu, we pop the stack to get the parent menu structure to display
-// A StackPointer (sp) holds the index of the "top-of-stack".  When we "push" an entry onto the stack,
-// we don't actually shift the items, we just increment the stack pointer and store the new pointer..  
-// For example, when pushing into L1 menus,  we store the L1 menu array pointer in levelStack[1] and change 
-// the sp to 1 so levelStack[1] is now considered the top-of-stack.  levelStack[0] is one level "down".  When 
-// we pop the stack, we just decrement the sp to get back to the parent.
-  
-struct menuItem *levelStack[5];   // Stack -  Array of pointers to structure-arrays
-int sp = 0;                       // Stack pointer (Index of the stack entry that is currenty the top-of-stack)
+const uint8_t MENU_ROWS = 4;          // 2X rows on the panel
+const uint8_t SCROLL_MARK_COL = 122; // 1X, right of the last 2X character
+
+// What displayMenu() last put up, so turning the knob within a page only has to move the '>'
+bool menuCursorMoved = false;  // Set by the knob, instead of dispUpdateNeeded, while in a menu
+const struct menu *shownMenu = 0;
+int shownMenuTop;              // First item in the window
+int shownCursor;
+uint8_t shownMenuFrame;        // oled.frame() when it was drawn.  Anything else drawn since means a full redraw.
+int menuRowsDrawn;             // Items of the window drawn so far
+bool menuCutShort = false;     // displayMenu() has the rest of the window to draw
 
 // Function prototype declarations
 void doNothing();
+void acquisitionTask();
+void inputTask();
+void menuTask();
+void weightTask();
+#ifdef ADAPTIVE_REFRESH
+void setRefresh(RefreshLevel level);
+#endif
+void batteryTask();
+void reportTask();
+void serialTask();
+void displayTask();
+void serviceDisplay();
+void traceRawSample(int32_t raw, uint32_t time);
+void traceSettings();
+bool uiBusy();
+void menuHome();
 void displayMenu();
+void displayMenuCursor();
+int menuWindowTop(int top, int position, int rows);
+void displayScrollMarks(int top, int rows);
 void displayMessage(const char * str, int delayVal);
 void displayWeights();
+void displayWeightLabels();
+void displayStability();
+void serviceLoadCell();
+void processSample(weight_t weight, uint32_t time);
+void handleStabilityEvent(StabilityEvent event);
+void addSampleConsumer(void (*consumer)(weight_t weight, uint32_t time));
+void capturePeak(weight_t weight, uint32_t time);
+void streamSample(weight_t weight, uint32_t time);
+bool waitForStable();
 void clearAllMem();
 void memClear();
 void memStore();
 void memRecall();
 void rezero();
+void serviceTare(KnobButton button);
+void startTare();
+void cancelTare();
+void startDataSet();
+bool dataSetReady();
+uint8_t dataSetPercent();
+void displayProgress(uint8_t percent);
 void enterKnownWeight();
 void calibrate();
+void serviceCalibration(KnobButton button);
+void endCalibration();
 void editCal();
 void saveCal();
-void waitForClick();
+void checkBattery();
+void readBattery();
+void displayBenchmark();
+void displayMemoryStats();
 int waitForClickOrDoubleClick();
+void acquisitionDelay(unsigned long delayVal);
+void printDecimal(Print &out, decimal_t val);
+void eepromGetDecimal(uint8_t key, decimal_t &val);
+void eepromPutDecimal(uint8_t key, decimal_t val);
 
 // ************************************************************************************************
 // Structure initialization
-// One structure template used for all menu items.  
-// For a given menu, we create an array of structure pointers to each of the menu's items.
-// To create a new menu, define another struct array, initialize with the menu's entry structures
-// and go create any necessary callback functions.
-// ************************************************************************************************
-struct menuItem {
-   const char *menuTitle;        // Name of the menu
-   int numMenuItems;             // Total number of menu items for a given level
-   int menuLevel;                // L0 is the top, each sub-menu pushed the level (L1, L2, etc.)
-   const char *menuItem;         // Item title
-   void (*clickFuncPtr)();       // Pointer to rotary-switch "click" callback function
-   void (*heldFuncPtr)();        // Pointer to rotary-switch "held" callback function
-   struct menuItem *childMenu;   // Pointer to the child menu structure-array
+// Menu item renderers, see displayMenu()
+void drawTitle(const struct menuItem &item, int index, uint8_t row);
+void drawMemory(const struct menuItem &item, int index, uint8_t row);
+void drawRefWeight(const struct menuItem &item, int index, uint8_t row);
+void drawCalVal(const struct menuItem &item, int index, uint8_t row);
+void drawBattery(const struct menuItem &item, int index, uint8_t row);
+
+// The menu tables are all in flash (Menu.h).  The item counts and levels are worked
+// out from the tables themselves by makeMenu().  The menus are declared first so
+// the items can point at their child menus.
+extern const struct menu L2_mem_menu;
+extern const struct menu L2_calibrate_menu;
+extern const struct menu L1_menu;
+
+const char enterRefTitle[] PROGMEM = "Enter Ref";
+const char runCalTitle[] PROGMEM = "Run Cal";
+const char editCalTitle[] PROGMEM = "Edit Cal";
+const char saveCalTitle[] PROGMEM = "Save Cal";
+const char memoryTitle[] PROGMEM = "Memory";
+const char clearMemTitle[] PROGMEM = "Clear Mem";
+const char reZeroTitle[] PROGMEM = "Re-Zero";
+const char calibrateTitle[] PROGMEM = "Calibrate";
+const char batteryTitle[] PROGMEM = "Battery";
+#ifdef MEMORY_STATS
+const char ramTitle[] PROGMEM = "RAM";
+#endif
+#ifdef DISPLAY_BENCHMARK
+const char benchmarkTitle[] PROGMEM = "Benchmark";
+#endif
+const char noTitle[] PROGMEM = "";
+
+// Needed to define a menu structure for the L0 level which is actually not a menu at all.
+// It's the display that shows the weight, but we needed a valid structure pointer for the
+// level stack so this is juat a do-nothing menu whose one item leads to L1.
+constexpr struct menuItem L0_items[] PROGMEM = {
+   subMenu(noTitle, L1_menu)
 };
+constexpr struct menu L0_menu PROGMEM = makeMenu(L0_items);
 
-// This is just a dummy placeholder for leaf-level menus that have no child as we 
-// need a valid structure pointer to store in the leaf's child-structure entry.
-struct menuItem noMenuPlaceholder[] = {
-   "noMenuPlaceholder",1,3,"No Menu",doNothing,doNothing,noMenuPlaceholder
+// L1 main menu.  The first level menu.  Displays additional sub-menu options.
+// Click the rotary-encoder to enter a sub-menu.  Double-click to return to the
+// Scale's weight screen.
+constexpr struct menuItem L1_items[] PROGMEM = {
+   subMenu(memoryTitle, L2_mem_menu),
+   action(clearMemTitle, clearAllMem),
+   action(reZeroTitle, rezero),
+   subMenu(calibrateTitle, L2_calibrate_menu),
+   action(batteryTitle, checkBattery, drawBattery)
+   #ifdef MEMORY_STATS
+   ,action(ramTitle, displayMemoryStats)
+   #endif
+   #ifdef DISPLAY_BENCHMARK
+   ,action(benchmarkTitle, displayBenchmark)
+   #endif
 };
+constexpr struct menu L1_menu PROGMEM = makeMenu(L1_items, L0_menu);
 
 // Menu for displaying/storing/clearing each of the store-result locations.
-// Currently we allow up to eight results to be stored (named M0-M7).
-struct menuItem L2_mem_menu[] = {
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M0 ",memStore,memClear,noMenuPlaceholder,
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M1 ",memStore,memClear,noMenuPlaceholder,
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M2 ",memStore,memClear,noMenuPlaceholder,
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M3 ",memStore,memClear,noMenuPlaceholder,
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M4 ",memStore,memClear,noMenuPlaceholder,
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M5 ",memStore,memClear,noMenuPlaceholder,
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M6 ",memStore,memClear,noMenuPlaceholder,
-   "L2_mem_menu",NUM_MEMORY_ENTRIES,2,"M7 ",memStore,memClear,noMenuPlaceholder
+// We allow up to NUM_MEMORY_ENTRIES results to be stored (named M0-M9).  They're all
+// the same apart from the number, so one item with no title stands for all of them
+// (see menuItemAt()) and drawMemory() makes up each one's name.  Click to store,
+// hold to clear.
+constexpr struct menuItem L2_mem_items[] PROGMEM = {
+   numberedItem(memStore, memClear, drawMemory)
 };
+constexpr struct menu L2_mem_menu PROGMEM = makeNumberedMenu(L2_mem_items, NUM_MEMORY_ENTRIES, L1_menu);
 
 // Calibration menu.  Allow the user to re-calibrate the scale.  They will need to 
 // supply a known weight.  The calibration is run and a new calibration constant is
 // generated.  The user can manually edit the cal value as well.
 // Finally, the cal constant can be stored in the EEPROM if desired.
-struct menuItem L2_calibrate_menu[] = {
-   "L2_calibrate_menu",4,2,"Enter Ref",enterKnownWeight,doNothing,noMenuPlaceholder,
-   "L2_calibrate_menu",4,2,"Run Cal",calibrate,doNothing,noMenuPlaceholder,
-   "L2_calibrate_menu",4,2,"Edit Cal",editCal,doNothing,noMenuPlaceholder,
-   "L2_calibrate_menu",4,2,"Save Cal",saveCal,doNothing,noMenuPlaceholder
-};
-
-// L1 main menu.  The first level menu.  Displays additional sub-menu options.
-// Click the rotary-encoder to enter a sub-menu.  Double-click to return to the
-// Scale's weight screen.
-struct menuItem L1_menu[] = {
-   "L1_menu",4,1,"Memory",doNothing,doNothing,L2_mem_menu,
-   "L1_menu",4,1,"Clear Mem",clearAllMem,doNothing,noMenuPlaceholder,
-   "L1_menu",4,1,"Re-Zero",rezero,doNothing,noMenuPlaceholder,
-   "L1_menu",4,1,"Calibrate",doNothing,doNothing,L2_calibrate_menu
+constexpr struct menuItem L2_calibrate_items[] PROGMEM = {
+   action(enterRefTitle, enterKnownWeight, drawRefWeight),
+   action(runCalTitle, calibrate),
+   action(editCalTitle, editCal, drawCalVal),
+   action(saveCalTitle, saveCal)
 };
+constexpr struct menu L2_calibrate_menu PROGMEM = makeMenu(L2_calibrate_items, L1_menu);
 
-// Needed to define a menu structure for the L0 level which is actually not a menu at all.
-// It's the display that shows the weight, but we needed a valid structure pointer for the
-// level stack so this is juat a do-nothing structure array.
-struct menuItem L0_menu[] = {
-   "L0_menu",1,0,"",doNothing,doNothing,L1_menu
-};
+// Create a stack to store the pointers to the current level menu structure array
+// We push the current menu level structure onto the stack each time we push into a sub-menu.
+// When returning from the sub-menu, we pop the stack to get the parent menu structure to display
+// A StackPointer (sp) holds the index of the "top-of-stack".  When we "push" an entry onto the stack,
+// we don't actually shift the items, we just increment the stack pointer and store the new pointer..  
+// For example, when pushing into L1 menus,  we store the L1 menu array pointer in levelStack[1] and change 
+// the sp to 1 so levelStack[1] is now considered the top-of-stack.  levelStack[0] is one level "down".  When 
+// we pop the stack, we just decrement the sp to get back to the parent.
+  
+// Only sub-menus are pushed, so the stack is as deep as the menu tree (menuDepth()).
+// The actions leave sp alone, and when one wants to go back to the weights it calls
+// menuHome().
+const uint8_t MENU_DEPTH = menuDepth(L0_menu);
+const struct menu *levelStack[MENU_DEPTH];   // Stack -  Array of pointers to menus (in flash)
+int sp = 0;                       // Stack pointer (Index of the stack entry that is currenty the top-of-stack)
 
 
 // ************************************************************************************
@@ -236,86 +490,124 @@ void setup()   {
    Serial.begin(115200);
    delay(1000);  // Wait a second to avoid double reset
 
-   // Initialize the EEPROM address array for weight storage.  Addresses are 
-   // four bytes apart as we are storing floats
-   for(int i=0;i<8;i++) {
-      mem_eepromAddress[i]=sizeof(float)+(i*sizeof(float));
-   }
+   // Find the latest calibration and stored weights in the EEPROM log
+   ValueLog::begin();
 
    // Load the weight storage array from the EEPROM
    for(int i=0;i<NUM_MEMORY_ENTRIES;i++) { 
-      EEPROM.get(mem_eepromAddress[i], storeArr[i]);
+      eepromGetDecimal(LOG_MEMORY + i, storeArr[i]);
+      #ifdef FLOAT_WEIGHT_MATH
+      if(isnan(storeArr[i])) {
+         storeArr[i] = 0;   // Never written (the fixed-point decode does this itself)
+      }
+      #endif
    }
    
    // Set up battery monitor pin
-   pinMode(BAT_PIN, INPUT);
+   pinMode(Board::BAT_PIN, INPUT);
 
    // Initalize the OLED display
-   #ifdef FIVE_KG_SCALE
-   oled.begin(&SH1106_128x64, 2, 9, 3);  // CS_PIN, DC_PIN, RST_PIN
-   #else
-   oled.begin(&SH1106_128x64, I2C_ADDRESS);
-   #endif
-
-   oled.setFont(System5x7);
+   oled.begin();
 
    // Display a "splash screen" during boot-up
    oled.set1X();
    oled.clear();
    oled.println();
    oled.set2X();
-   #ifdef KITTY_SCALE
-   oled.println(F("   Range"));
-   oled.set1X();
-   oled.println();
-   oled.set2X();
-   oled.println(F(" 0-44 lbs"));
-   #elif defined FIVE_KG_SCALE
-   oled.println(F("   Range"));
-   oled.set1X();
-   oled.println();
-   oled.set2X();
-   oled.println(F(" 0-11 lbs"));
-   #else
-   oled.println(F("Property Of"));
-   oled.set1X();
-   oled.println();
-   oled.set2X();
-   oled.println(F(" J. Penney"));
-   #endif
+   if(Board::SPLASH_OWNER) {
+      oled.println(F("Property Of"));
+      oled.set1X();
+      oled.println();
+      oled.set2X();
+      oled.println(F(" J. Penney"));
+   } else {
+      oled.println(F("   Range"));
+      oled.set1X();
+      oled.println();
+      oled.set2X();
+      oled.print(F(" 0-"));
+      oled.print(Board::RANGE_LBS);
+      oled.println(F(" lbs"));
+   }
+   oled.drain();   // Nothing to keep sampling yet, so get the splash up in one go
    delay(1000);
   
    // Initialize the HX711/ADC
    loadCell.begin();
 
-   // Initialize the rotary encoder.  Enable the Arduino builtin pullup resistors.
-   pinMode(ENC_A, INPUT_PULLUP);
-   pinMode(ENC_B, INPUT_PULLUP);
-   pinMode(ENC_SW, INPUT_PULLUP);
-   encoder = new ClickEncoder(ENC_A, ENC_B, ENC_SW, 4);  // Set up with 4 steps per notch for our encoder
-   encoder->setAccelerationEnabled(false);  // Don't want acceleration
+   // Initialize the rotary encoder.
+   encoder.begin(Board::ENC_A, Board::ENC_B, Board::ENC_SW, 4);  // Set up with 4 steps per notch for our encoder
 
    // Set up timer to use with rotary encoder.  The timer is used by the library 
    // to determine double-click, long hold, short hold, etc.
-   Timer1.initialize(1000);
-   Timer1.attachInterrupt(timerIsr);
+   ScaleTimer::begin(1000, timerIsr);
   
    // Load the calibration constant from EEPROM
-   // EEPROM.put(calVal_eepromAdress, 1.0);  // Uncomment for first time power-on to set to an initialization value
-   EEPROM.get(calVal_eepromAdress, calVal);
+   // eepromPutDecimal(LOG_CAL_VAL, DECIMAL_ONE);  // Uncomment for first time power-on to set to an initialization value
+   eepromGetDecimal(LOG_CAL_VAL, calVal);
 
    loadCell.start(3000, true);    // Start the ADC, wait a few seconds then get zero out the reading.
-   loadCell.setCalFactor(calVal); // Set calibration value (float)
+   loadCell.setCalFactor(calVal); // Set calibration value
 
    // Get OLED character offsets so we know where to clear fields
    rowsPerChar = oled.fontRows();
    col = oled.fieldWidth(strlen(padding)); 
+   #ifdef BIG_DIGITS
+   poundsField.begin(BIG_WEIGHT_COL, 0, BIG_WEIGHT_SLOTS, BIG_DIGITS);
+   #if BIG_DIGITS == 3
+   kilogramsField.begin(BIG_WEIGHT_COL, KILOGRAMS_ROW, BIG_WEIGHT_SLOTS, BIG_DIGITS);
+   #else
+   kilogramsField.begin(col, KILOGRAMS_ROW, WEIGHT_FIELD_WIDTH, 2);
+   #endif
+   #else
+   poundsField.begin(col, rowsPerChar*0, WEIGHT_FIELD_WIDTH, 2);
+   kilogramsField.begin(col, rowsPerChar*2, WEIGHT_FIELD_WIDTH, 2);
+   #endif
+   oled.set1X();
+   stableField.begin(oled.fieldWidth(8), STABLE_ROW, 6, 1);   // Centered
+   oled.set2X();
 
    // Initialize level-0 of the display stack.  Level-0 is the weight display. Level-1 starts the menu display.  
    // All lower levels are more layers of sub-menu.
-   levelStack[0] = L0_menu;        // Initialize to display the weights
+   levelStack[0] = &L0_menu;        // Initialize to display the weights
    cursorPosition = 0;             // Start with menu item cursor at first row
 
+   #ifdef RAW_TRACE
+   loadCell.setRawHandler(traceRawSample);
+   #endif
+
+   #ifdef HIGH_RATE_MODE
+   addSampleConsumer(capturePeak);
+   #ifdef SERIAL_STREAM_SAMPLES
+   addSampleConsumer(streamSample);
+   #endif
+   #ifdef HX711_ISR_MODE
+   loadCell.setSampleHandler(processSample);   // Every conversion goes to processSample() as it is drained
+   #endif
+   #endif
+
+   // Everything loop() does, most important first.  Acquisition always goes ahead of
+   // the knob, and the knob ahead of any rendering that's waiting.
+   scheduler.addTask(acquisitionTask, F("acquire"), ACQUISITION_PERIOD, 0);
+   scheduler.addTask(inputTask, F("input  "), INPUT_PERIOD, 1);
+   scheduler.addTask(menuTask, F("menu   "), MENU_PERIOD, 2);
+   #ifdef ADAPTIVE_REFRESH
+   weightTaskId = scheduler.addTask(weightTask, F("weight "), REFRESH_MOVING_MS, 3);
+   #else
+   scheduler.addTask(weightTask, F("weight "), DISPLAY_REFRESH_TIME, 3);
+   #endif
+   scheduler.addTask(batteryTask, F("battery"), DISPLAY_REFRESH_TIME, 4);
+   scheduler.addTask(serialTask, F("serial "), SERIAL_PERIOD, 5);
+   #ifdef SCHEDULER_REPORT
+   scheduler.addTask(reportTask, F("report "), SCHEDULER_REPORT_MS, 6);
+   #endif
+   scheduler.addTask(displayTask, F("display"), DISPLAY_PERIOD, 7);   // Always due, so it has to come last
+
+   #ifdef RUN_BENCHMARKS
+   benchmarkWeightMath();
+   benchmarkSettleTime();
+   benchmarkNumberFormat();
+   #endif
 }
 
 
@@ -325,21 +617,46 @@ void setup()   {
 // ************************************************************************************
 // ************************************************************************************
 void loop() {
+   PROFILE_BEGIN(PROFILE_LOOP);
+   scheduler.runNext();
+   oled.flush();   // Finish off whatever screen the task drew
+   PROFILE_END(PROFILE_LOOP);
+}
 
-   // If we are not displaying the weights, go update the current menu list.
-   // Only update if something changed or this is the initial display of the menu.
-   if(sp != 0 && dispUpdateNeeded) {
-      displayMenu();
+//************************************************************************************
+// Scheduler tasks.  What used to be done in turn by loop(), now run by the scheduler
+// at their own rates.  See setup() for the periods and priorities.
+//************************************************************************************
+
+// Go measure the object sitting on the scale
+void acquisitionTask() {
+   serviceLoadCell();
+}
+
+// The rotary encoder and its switch.  This is our control knob to scroll/select menu items.
+void inputTask() {
+   // A re-zero or calibration in progress gets the knob until it's done
+   if(uiBusy()) {
+      value += encoder.getValue();   // Swallow any turns so the menu cursor doesn't jump afterwards
+      last = value;
+      KnobButton button = encoder.getButton();
+      if(tareState != TARE_IDLE) {
+         serviceTare(button);
+      } else {
+         serviceCalibration(button);
+      }
+      return;
    }
 
    // ***************************************************************************
-   // Check the rotary encoder.  This is our control knob to scroll/select menu items.
+   // Scroll through the menu items.
    // Display in groups of four rows as that's all we have in the OLED 2X font
    // ***************************************************************************
-   value += encoder->getValue();
+   PROFILE_BEGIN(PROFILE_ENCODER);
+   value += encoder.getValue();
    int arrLen;
    if (value != last) {
-      arrLen = levelStack[sp][0].numMenuItems;
+      arrLen = menuCount(levelStack[sp]);
       if(value > last) { 
          cursorPosition--;  // cursor moving up
          // Wrap the cursor if at the top
@@ -355,47 +672,55 @@ void loop() {
       }
       last = value;
 
-      dispUpdateNeeded = true;
+      if(sp == 0) {
+         dispUpdateNeeded = true;
+      } else {
+         menuCursorMoved = true;
+      }
    }
 
    // ***************************************************************************
    // Check if user is entering/exiting a menu
    // See if the encoder button was clicked, double clicked, held, or released
    // ***************************************************************************
-   ClickEncoder::Button b = encoder->getButton();
+   KnobButton b = encoder.getButton();
 
-   if (b != ClickEncoder::Open) {
-      int cursorPositionBeforeClick;
+   if (b != KNOB_OPEN) {
+      struct menuItem clickedItem;
       switch (b) {
 
-         case ClickEncoder::Released:
+         case KNOB_RELEASED:
             buttonBeingHeld = false;
             break;
 
-         case ClickEncoder::Clicked:
-            sp++;
-            cursorPositionBeforeClick = cursorPosition;
-            levelStack[sp]=levelStack[sp-1][cursorPositionBeforeClick].childMenu; // Store child structure-array pointer in stack
-            levelStack[sp-1][cursorPositionBeforeClick].clickFuncPtr();           // Execute parent callback for clicked item
+         case KNOB_CLICKED:
+            clickedItem = menuItemAt(levelStack[sp], cursorPosition);
+            if(clickedItem.childMenu) {
+               sp++;
+               levelStack[sp]=clickedItem.childMenu;   // Store child menu pointer in stack
+            }
+            clickedItem.clickFuncPtr();             // Execute the callback for clicked item
             dispUpdateNeeded = true;
             buttonBeingHeld = false;
             break;
             
-         case ClickEncoder::Held:
+         case KNOB_HELD:
             if(buttonBeingHeld) {
                break;
             }else{
-               sp++;
-               cursorPositionBeforeClick = cursorPosition;
-               levelStack[sp]=levelStack[sp-1][cursorPositionBeforeClick].childMenu; // Store child structure-array pointer in stack
-               levelStack[sp-1][cursorPositionBeforeClick].heldFuncPtr();            // Execute parent callback for held item
+               clickedItem = menuItemAt(levelStack[sp], cursorPosition);
+               if(clickedItem.childMenu) {
+                  sp++;
+                  levelStack[sp]=clickedItem.childMenu;   // Store child menu pointer in stack
+               }
+               clickedItem.heldFuncPtr();              // Execute the callback for held item
                dispUpdateNeeded = true;
                buttonBeingHeld = true;
                break;
             }
 
-         case ClickEncoder::DoubleClicked:
-            if(levelStack[sp]->menuLevel != 0) {
+         case KNOB_DOUBLE_CLICKED:
+            if(menuLevel(levelStack[sp]) != 0) {
                sp--;
                cursorPosition=0;
                dispUpdateNeeded = true;
@@ -404,72 +729,208 @@ void loop() {
           default:
             break;
       }
-   }    
-   
-   // *****************************************************
-   // Go measure the object sitting on the scale
-   // *****************************************************
-   static boolean newDataReady = 0;
-
-   if(loadCell.update()) {
-      newDataReady = true;
    }
-   if(newDataReady) {
-      if(millis() > adc_read_time + readInterval) {
+   PROFILE_END(PROFILE_ENCODER);
+}
 
-         // Read the HX711 to the latest measurment
-         // Store the previous reading for when we want to see if the measurment is stable
-         lastKilograms = kilograms;
-         pounds = loadCell.getData();
-         kilograms = pounds * .454;
-         newDataReady = 0;
-         adc_read_time = millis();
+// If we are not displaying the weights, go update the current menu list.
+// Only update if something changed or this is the initial display of the menu.
+void menuTask() {
+   #ifdef ADAPTIVE_REFRESH
+   if(sp != 0) {
+      setRefresh(REFRESH_MOVING);   // Undim the panel for the menu, and be quick back to the weights
+   }
+   #endif
+   if(sp != 0 && (dispUpdateNeeded || menuCursorMoved || menuCutShort) && !uiBusy()) {
+      PROFILE_BEGIN(PROFILE_MENU);
+      if(dispUpdateNeeded || menuCutShort) {
+         displayMenu();
+      } else {
+         displayMenuCursor();
       }
+      PROFILE_END(PROFILE_MENU);
+   }
+}
+
+// Top level weight display.  Only updating periodically so we don't flash the screen so much.
+// With ADAPTIVE_REFRESH, how often depends on what the weight is doing (setRefresh()).
+void weightTask() {
+   if(sp != 0) {
+      return;
    }
 
-   // ****************************************************************
-   // Check if the top level weight display update is needed
-   // Only updating periodically so we don't flash the screen so much 
-   // ****************************************************************
-   if(sp == 0 && (millis() > (displayUpdateTimer + DISPLAY_REFRESH_TIME))) {
+   // Only update the screen if what it shows would change.  When weight is stable, screen
+   // stops flashing.  The "flashing" is actually the screen being cleared then re-written.
+   if(weightToDecimal(pounds) != shownPounds || weightToDecimal(kilograms) != shownKilograms ||
+      stability.isStable() != shownStable || dispUpdateNeeded || weightsBehind){
+      PROFILE_BEGIN(PROFILE_WEIGHTS);
+      displayWeights();
+      PROFILE_END(PROFILE_WEIGHTS);
+      #ifdef ADAPTIVE_REFRESH
+      lastWeightChange = millis();
+      #endif
+   }
 
-      // Only update the screen if the weight is changing.  When weight is stable, screen
-      // stops flashing.  The "flashing" is actually the screen being cleared then re-written.
-      if(abs(pounds - lastPounds) > .001 || dispUpdateNeeded){
-         displayWeights();
-         dispUpdateNeeded = false;
-      }
-      lastPounds = pounds; 
-       
-      // The battery is connected to an analog input pin through a 10k/10k resistor divider.
-      // So, voltage at the analog pin is 1/2 the supply voltage.  We read the divider, 
-      // map that to 0-5v then multiple by two to give us the actual battery voltage.
-
-      battery_voltage = map(analogRead(BAT_PIN), 0, 1023, 0, 5000) * 2;
-      if(battery_voltage < low_battery_limit) {
-           
-         // Will blink the warning message if the battery is low
-         display_low_battery = !display_low_battery;
-      } else {
-         display_low_battery = false;
-      }
-      oled.println();
-      oled.set1X();
-      oled.println();
+   #ifdef ADAPTIVE_REFRESH
+   if(!stability.isStable()) {
+      setRefresh(REFRESH_MOVING);
+   } else if(millis() - lastWeightChange < IDLE_AFTER_MS) {
+      setRefresh(REFRESH_STABLE);
+   } else {
+      setRefresh(REFRESH_IDLE);
+   }
+   #endif
+}
 
-      if(display_low_battery) {        
-         //oled.println(F("      Low Battery      "));
-         oled.print(F("Low Battery => "));
-         char str[5];
-         float bv = battery_voltage/1000.0;
-         sprintf(str, "%d.%02d V", (int)bv, (int)(bv*100)%100);
-         oled.println(str);
-      } else {
-         oled.clearToEOL();
+#ifdef ADAPTIVE_REFRESH
+//************************************************************************************
+// Change how often weightTask() runs.  Quick while a load is going on or coming off,
+// a slow heartbeat once the reading has settled (it's held, so there's nothing new to
+// show), and slower still with the panel dimmed once nothing has changed for
+// IDLE_AFTER_MS.  Speeding up runs the task straight away (Scheduler::setPeriod()).
+//************************************************************************************
+void setRefresh(RefreshLevel level) {
+   if(level == refreshLevel) {
+      return;
+   }
+   scheduler.setPeriod(weightTaskId, refreshPeriods[level]);
+   if(level == REFRESH_IDLE) {
+      oled.setContrast(IDLE_CONTRAST);
+   } else if(refreshLevel == REFRESH_IDLE) {
+      oled.setContrast(OLED_CONTRAST);
+   }
+   refreshLevel = level;
+}
+#endif
+
+// Low battery warning on the bottom line of the weight display
+void batteryTask() {
+   if(sp != 0) {
+      return;
+   }
+
+   readBattery();
+   uint8_t drops = oled.drops();
+   if(battery_voltage < low_battery_limit) {
+        
+      // Will blink the warning message if the battery is low
+      display_low_battery = !display_low_battery;
+   } else {
+      display_low_battery = false;
+   }
+   oled.set1X();
+   oled.setCursor(0, BATTERY_ROW);
+
+   if(display_low_battery) {        
+      //oled.println(F("      Low Battery      "));
+      oled.print(F("Low Battery => "));
+      printFixed(oled, battery_voltage / 10, 2);
+      oled.print(F(" V"));
+      batteryWarningShown = true;
+   } else if(batteryWarningShown) {
+      oled.clearToEOL();   // Only when there's a warning to take down, not every pass
+      batteryWarningShown = oled.drops() != drops;   // Again next time if the queue was full
+   }
+   oled.set2X();
+}
+
+// The battery is connected to an analog input pin through a 10k/10k resistor divider.
+// So, voltage at the analog pin is 1/2 the supply voltage.  We read the divider, 
+// map that to 0-5v then multiple by two to give us the actual battery voltage.
+void readBattery() {
+   PROFILE_BEGIN(PROFILE_BATTERY);
+   int batteryReading = analogRead(Board::BAT_PIN);
+   PROFILE_END(PROFILE_BATTERY);
+   battery_voltage = map(batteryReading, 0, 1023, 0, 5000) * 2;
+}
+
+// Commands from the serial port.  One character each:
+//    t   Start/stop streaming raw HX711 conversions (RAW_TRACE builds)
+//    p   Print the profiling counters and start them over (PROFILING builds)
+//    d   Display queue stats: longest send slice, most queued, times it was full
+//    m   RAM use: static, heap, stack and free, and the stack's high water mark (MEMORY_STATS builds)
+//    e   EEPROM log: laps (the wear on each cell), records written and writes skipped as unchanged
+void serialTask() {
+   while(Serial.available() > 0) {
+      switch(Serial.read()) {
+         #ifdef RAW_TRACE
+         case 't':
+            traceOn = !traceOn;
+            if(traceOn) {
+               Serial.println(F("# raw trace"));
+               traceSettings();
+            } else {
+               Serial.println(F("# end trace"));
+            }
+            break;
+         #endif
+         #ifdef PROFILING
+         case 'p':
+            Profiler::report(Serial);
+            break;
+         #endif
+         case 'd':
+            displayQueue.report(Serial);
+            break;
+         #ifdef MEMORY_STATS
+         case 'm':
+            reportMemory(Serial);
+            break;
+         #endif
+         case 'e':
+            ValueLog::report(Serial);
+            break;
+         default:
+            break;
       }
-      oled.set2X();
-      displayUpdateTimer = millis();
-  }
+   }
+}
+
+#ifdef RAW_TRACE
+//************************************************************************************
+// Raw trace capture.  Every conversion goes out as "R,<ms>,<raw counts>", and the
+// calibration and tare as "C,<calVal>" and "Z,<tare counts>" at the start and again
+// whenever they change.  Anything else on the port is ignored by the replay tool, so
+// the STABLE/MOVING lines can stay in the capture.
+//************************************************************************************
+void traceRawSample(int32_t raw, uint32_t time) {
+   if(traceOn) {
+      Serial.print(F("R,"));
+      Serial.print(time);
+      Serial.print(',');
+      Serial.println(raw);
+   }
+}
+
+void traceSettings() {
+   if(traceOn) {
+      Serial.print(F("C,"));
+      printDecimal(Serial, loadCell.getCalFactor());
+      Serial.println();
+      Serial.print(F("Z,"));
+      Serial.println(loadCell.getTareOffset());
+   }
+}
+#else
+void traceSettings() {
+}
+#endif
+
+// Send queued display commands, a slice at a time
+void displayTask() {
+   serviceDisplay();
+}
+
+#ifdef SCHEDULER_REPORT
+// Where the loop's time is going, on the serial port
+void reportTask() {
+   scheduler.report(Serial);
+}
+#endif
+
+// True while a re-zero or calibration owns the knob and the screen
+bool uiBusy() {
+   return tareState != TARE_IDLE || calState != CAL_IDLE;
 }
 
 //********************************************************************
@@ -482,79 +943,255 @@ void loop() {
 void doNothing(){
 }
 
+// Back to the weight screen from however deep in the menus we are
+void menuHome() {
+   sp = 0;
+   cursorPosition = 0;
+   dispUpdateNeeded = true;
+}
+
 //************************************************************************************
 // Update the display to show the current weight measurments
-// This is the L0 display level
+// This is the L0 display level.  The labels only go up when we've just come here
+// (dispUpdateNeeded), otherwise just the digits that changed are rewritten.  Whatever
+// didn't fit in the display queue goes next time (weightsBehind), carrying on from
+// where it got to rather than clearing again, which would only start it over.
 //************************************************************************************
 void displayWeights() {
-         oled.clear();
-         oled.set2X();
-         oled.print(padding);
-         oled.print("0.00");
-         oled.println(F("  lbs"));
-         oled.println();
-         oled.print(padding);
-         oled.print("0.00");
-         oled.println(F("  kg"));
-         oled.clearField(col,rowsPerChar*0,5);
-         
-         // keep the digits lined up with or without minus sign in value)
-         if(pounds > 0) {
-            oled.print(" ");
-         }
-         oled.print(pounds);
-         oled.clearField(col,rowsPerChar*2,5);
-         
-         // keep the digits lined up with or without minus sign in value)
-         if(kilograms > 0) {
-            oled.print(" ");
-         }
-         oled.print(kilograms);    
+   uint8_t drops = oled.drops();
+   if(dispUpdateNeeded) {
+      oled.clear();
+      poundsField.forget();
+      kilogramsField.forget();
+      stableField.forget();
+      batteryWarningShown = false;
+      dispUpdateNeeded = false;
+      labelsBehind = true;
+   } else {
+      oled.resume();
+   }
+   if(labelsBehind) {
+      displayWeightLabels();
+      labelsBehind = oled.drops() != drops;
+   }
+
+   // Right-justified, so the digits stay lined up with or without a minus sign.  The
+   // field's last character is the blank before the label, only "-12.34" needs it.
+   poundsField.start();
+   printFixed(poundsField, decimalToCenti(weightToDecimal(pounds)), 2, WEIGHT_FIELD_WIDTH - 1);
+   poundsField.show(oled);
+
+   kilogramsField.start();
+   printFixed(kilogramsField, decimalToCenti(weightToDecimal(kilograms)), 2, WEIGHT_FIELD_WIDTH - 1);
+   kilogramsField.show(oled);
+
+   shownPounds = weightToDecimal(pounds);
+   shownKilograms = weightToDecimal(kilograms);
+   displayStability();
+   weightsBehind = oled.drops() != drops;
+}
+
+//************************************************************************************
+// The parts of the weight screen that don't change, over the cleared panel.  Drawn
+// again if some didn't fit, the 2X ones cost nothing the second time.
+//************************************************************************************
+void displayWeightLabels() {
+   oled.set2X();
+   #if BIG_DIGITS == 3
+   // Level with the bottom of the digits
+   oled.setCursor(BIG_LABEL_COL, BIG_DIGIT_PAGES - 2);
+   oled.print(F("lbs"));
+   oled.setCursor(BIG_LABEL_COL, KILOGRAMS_ROW + BIG_DIGIT_PAGES - 2);
+   oled.print(F("kg"));
+   #elif BIG_DIGITS == 4
+   oled.set1X();
+   oled.setCursor(BIG_LABEL_COL, BIG_DIGIT_PAGES - 1);
+   oled.print(F("lbs"));
+   oled.set2X();
+   oled.setCursor(col + oled.fieldWidth(WEIGHT_FIELD_WIDTH), KILOGRAMS_ROW);
+   oled.print(F("kg"));
+   #else
+   oled.setCursor(col + oled.fieldWidth(WEIGHT_FIELD_WIDTH), rowsPerChar*0);
+   oled.print(F("lbs"));
+   oled.setCursor(col + oled.fieldWidth(WEIGHT_FIELD_WIDTH), rowsPerChar*2);
+   oled.print(F("kg"));
+   #endif
+}
+
+//************************************************************************************
+// Show whether the weight has settled.  Small text on the spare line under the kg.
+//************************************************************************************
+void displayStability() {
+   stableField.start();
+   if(stability.isStable()) {
+      stableField.print(F("STABLE"));
+   }
+   stableField.show(oled);
+   shownStable = stability.isStable();
 }
 //************************************************************************************
 // Update the display to show the menu for a given stack level
-// Display in groups of four rows as that is all the OLED can display with 2X font size
+// The OLED only has room for MENU_ROWS rows in the 2X font, so we show a window of
+// the menu that follows the cursor, with marks at the right when there's more above
+// or below.  Only the items in the window are looked at, however long the menu is.
+// If the display queue fills up part way, we stop at that item and come back for the
+// rest on the next pass (menuCutShort), as long as it's still the same window.
 //************************************************************************************
 void displayMenu(){
-   int startIndex,stopIndex;
-   int rows=levelStack[sp][0].numMenuItems;
+   int rows=menuCount(levelStack[sp]);
    if(cursorPosition > rows -1) {
       cursorPosition = 0;
    }
-   oled.clear();
+   int top = menuWindowTop(levelStack[sp] == shownMenu ? shownMenuTop : 0, cursorPosition, rows);
+   int bottom = top + MENU_ROWS < rows ? top + MENU_ROWS : rows;
+
+   if(menuCutShort && !dispUpdateNeeded && levelStack[sp] == shownMenu && top == shownMenuTop &&
+      cursorPosition == shownCursor && oled.frame() == shownMenuFrame) {
+      oled.resume();
+   } else {
+      oled.clear();
+      menuRowsDrawn = 0;
+      shownMenu = levelStack[sp];
+      shownMenuTop = top;
+      shownCursor = cursorPosition;
+      shownMenuFrame = oled.frame();
+   }
    oled.set2X();
 
-   if(cursorPosition > 3) {
-      startIndex=4;
-      stopIndex=rows;
-   }else{
-      startIndex=0;
-      if(rows < 4) {
-         stopIndex=rows;
-      }else{
-         stopIndex=4;
-      }
-   }
-   for(int i=startIndex; i < stopIndex ; i++){
+   // Each item draws itself (drawFuncPtr), so the ones with a value show it
+   uint8_t drops = oled.drops();
+   for(int i=top + menuRowsDrawn; i < bottom && oled.drops() == drops; i++){
+      uint8_t row = (i - top) * oled.fontRows();
+      oled.setCursor(0, row);
       if(cursorPosition == i) {
          oled.print(">");
       }else{
          oled.print(" ");
       }
-      oled.print(levelStack[sp][i].menuItem);
-
-      // Special case for memory menu.  We want to display the vaule for each memory location.
-      if(strcmp(levelStack[sp][i].menuTitle,"L2_mem_menu") == 0) {
-         oled.print(storeArr[i]);
-         oled.set1X();
-         oled.print(" lbs");
-         oled.set2X();
-         oled.println();
-      }else{
-         oled.println();
+      struct menuItem item = menuItemAt(levelStack[sp], i);
+      item.drawFuncPtr(item, i, row);
+      oled.set2X();
+      if(oled.drops() == drops) {
+         menuRowsDrawn++;
       }
    }
+   if(oled.drops() == drops) {
+      displayScrollMarks(top, rows);
+   }
+   menuCutShort = oled.drops() != drops;
    dispUpdateNeeded = false;
+   menuCursorMoved = false;
+}
+
+//************************************************************************************
+// Menu item renderers.  Each one is called with the cursor just past the 2X cursor
+// marker at the start of its row (row, in pages), and draws the item's title and
+// any value that goes with it.  index is the item's place in its menu.
+//************************************************************************************
+void drawTitle(const struct menuItem &item, int index, uint8_t row) {
+   oled.print(menuTitle(item));
+}
+
+// Memory slot.  Its name from its number, the stored weight, then small "lbs" if it
+// fits before the scroll marks.  A long weight ("12.34") only leaves room for "lb",
+// a longer one ("-12.34") for nothing.
+void drawMemory(const struct menuItem &item, int index, uint8_t row) {
+   char weight[NUMBER_BUFFER_SIZE];
+   uint8_t length = formatFixed(weight, decimalToCenti(storeArr[index]), 2);
+   oled.print('M');
+   oled.print(index);
+   oled.print(' ');
+   oled.print(weight);
+   uint8_t end = oled.fieldWidth(1 + 1 + (index < 10 ? 1 : 2) + 1 + length);   // Marker, "M9 " and the weight
+   oled.set1X();
+   if(end + oled.fieldWidth(4) <= SCROLL_MARK_COL) {
+      oled.print(F(" lbs"));
+   } else if(end + oled.fieldWidth(2) <= SCROLL_MARK_COL) {
+      oled.print(F("lb"));
+   }
+}
+
+// A 2X title leaves no room for a value beside it, so these two go in 1X, the
+// title on the top page of the row and the value under it.
+static void drawSmallTitle(const struct menuItem &item, uint8_t row) {
+   uint8_t col = oled.fieldWidth(1);   // Past the marker
+   oled.set1X();
+   oled.setCursor(col, row);
+   oled.print(menuTitle(item));
+   oled.setCursor(col, row + 1);
+}
+
+void drawRefWeight(const struct menuItem &item, int index, uint8_t row) {
+   drawSmallTitle(item, row);
+   printDecimal(oled, calRefWeight);
+   oled.print(F(" lbs"));
+}
+
+void drawCalVal(const struct menuItem &item, int index, uint8_t row) {
+   drawSmallTitle(item, row);
+   printDecimal(oled, calVal);
+}
+
+// Battery voltage to a tenth, small and clear of the scroll marks.  It's read on the
+// weight screen, or by clicking here (checkBattery()).
+void drawBattery(const struct menuItem &item, int index, uint8_t row) {
+   oled.print(menuTitle(item));
+   oled.set1X();
+   oled.setCursor(SCROLL_MARK_COL - oled.fieldWidth(4), row);   // "9.6V"
+   if(battery_voltage < 10000) {
+      printFixed(oled, battery_voltage / 100, 1);
+   } else {
+      oled.print(F("10"));   // The top of the divider's range
+   }
+   oled.print('V');
+}
+
+//************************************************************************************
+// The knob moved the cursor.  If it's still on the page that's up, just move the '>'
+// from the old row to the new one, otherwise draw the new page.
+//************************************************************************************
+void displayMenuCursor() {
+   if(levelStack[sp] != shownMenu || oled.frame() != shownMenuFrame ||
+      menuWindowTop(shownMenuTop, cursorPosition, menuCount(levelStack[sp])) != shownMenuTop) {
+      displayMenu();
+      return;
+   }
+   oled.set2X();
+   oled.setCursor(0, (shownCursor - shownMenuTop) * oled.fontRows());
+   oled.print(' ');
+   oled.setCursor(0, (cursorPosition - shownMenuTop) * oled.fontRows());
+   oled.print('>');
+   shownCursor = cursorPosition;
+   menuCursorMoved = false;
+}
+
+// First item in the menu window.  It scrolls as little as it can to keep the cursor in
+// view, so going past the bottom row moves everything up one.
+int menuWindowTop(int top, int position, int rows) {
+   if(position < top) {
+      top = position;
+   } else if(position >= top + MENU_ROWS) {
+      top = position - MENU_ROWS + 1;
+   }
+   if(top > rows - MENU_ROWS) {
+      top = rows > MENU_ROWS ? rows - MENU_ROWS : 0;
+   }
+   return top;
+}
+
+// '^' at the top right when there's more of the menu above the window, 'v' at the
+// bottom right when there's more below.  1X, in the strip past the last 2X character.
+void displayScrollMarks(int top, int rows) {
+   oled.set1X();
+   if(top > 0) {
+      oled.setCursor(SCROLL_MARK_COL, 0);
+      oled.print('^');
+   }
+   if(top + MENU_ROWS < rows) {
+      oled.setCursor(SCROLL_MARK_COL, MENU_ROWS * 2 - 1);
+      oled.print('v');
+   }
+   oled.set2X();
 }
 
 //************************************************************************************
@@ -568,16 +1205,22 @@ void memStore() {
    displayMessage("DoubleClik\nto Store",0);
    oled.println("SingleClik\nto Abort");
    clickType=waitForClickOrDoubleClick();
+   #ifdef STORE_WAIT_FOR_STABLE
+   if(clickType == 2 && !waitForStable()) {
+      displayMessage("Not Stable\nStore\nAborted",1000);
+      dispUpdateNeeded = true;
+      return;
+   }
+   #endif
    if(clickType == 2) {
-      storeArr[cursorPosition]=pounds;
-      EEPROM.put(mem_eepromAddress[cursorPosition], storeArr[cursorPosition]);
-      EEPROM.get(mem_eepromAddress[cursorPosition], storeArr[cursorPosition]);
+      storeArr[cursorPosition]=weightToDecimal(pounds);
+      eepromPutDecimal(LOG_MEMORY + cursorPosition, storeArr[cursorPosition]);
+      eepromGetDecimal(LOG_MEMORY + cursorPosition, storeArr[cursorPosition]);
       displayMessage("Stored\nWeight",1000);
    }else{
       displayMessage("Store\nAborted",1000);
    }
    dispUpdateNeeded = true;
-   sp--;
 }
 
 //************************************************************************************
@@ -585,23 +1228,22 @@ void memStore() {
 // The user long-pushed the rotary button so just clear this one location.
 //************************************************************************************
 void memClear() {
-   storeArr[cursorPosition]=0.00;
-   EEPROM.put(mem_eepromAddress[cursorPosition], storeArr[cursorPosition]);
+   storeArr[cursorPosition]=0;
+   eepromPutDecimal(LOG_MEMORY + cursorPosition, storeArr[cursorPosition]);
    dispUpdateNeeded = true;
-   sp--;
 }
 
 //************************************************************************************
 // Clear all the memory locations
-// Easy way to clear all eight locations when starting another round of measurments.
+// Easy way to clear all the locations when starting another round of measurments.
+// Locations that are already clear aren't written again.
 //************************************************************************************
 void clearAllMem() {
    displayMessage("Clearing\nMemory...",1000);
    for(int i=0;i<NUM_MEMORY_ENTRIES;i++) {
-      storeArr[i]=0.00;
-      EEPROM.put(mem_eepromAddress[i], storeArr[i]);
+      storeArr[i]=0;
+      eepromPutDecimal(LOG_MEMORY + i, storeArr[i]);
    }
-   sp--; // Jump back to the L1 display
 }
 
 //************************************************************************************
@@ -609,11 +1251,102 @@ void clearAllMem() {
 // null out (like a tray to put items in).
 //************************************************************************************
 void rezero() {
-   loadCell.tareNoDelay();  // Reset the scale to zero
-   displayMessage("Zeroing\nScale...",1000);
-   sp-=2; // Jump back to the top weight display
-   cursorPosition=0;
-   dispUpdateNeeded = true;
+   savedTareOffset = loadCell.getTareOffset();
+   startTare();  // Reset the scale to zero
+   displayMessage("Zeroing\nScale...",0);
+   tareState = TARE_ZEROING;
+}
+
+//************************************************************************************
+// One step of the re-zero.  Called from loop() until the tare lands or the user
+// double-clicks to cancel it.
+//************************************************************************************
+void serviceTare(KnobButton button) {
+   if(button == KNOB_DOUBLE_CLICKED) {
+      cancelTare();
+      tareState = TARE_IDLE;
+      dispUpdateNeeded = true;   // Back to the menu we came from
+      return;
+   }
+   if(loadCell.getTareStatus()) {
+      traceSettings();
+      peakPounds = 0;
+      tareState = TARE_IDLE;
+      menuHome(); // Jump back to the top weight display
+      return;
+   }
+   displayProgress(dataSetPercent());
+}
+
+//************************************************************************************
+// Kick off a tare without waiting for it
+//************************************************************************************
+void startTare() {
+   #ifndef HX711_ISR_MODE
+   tareRestorePending = false;   // This tare replaces any cancelled one still running
+   #endif
+   loadCell.tareNoDelay();
+   startDataSet();
+   shownProgress = NO_PROGRESS;
+}
+
+//************************************************************************************
+// Abandon a tare and keep the old zero
+//************************************************************************************
+void cancelTare() {
+   #ifdef HX711_ISR_MODE
+   loadCell.cancelTare();
+   #else
+   // The library can't abort a tare.  serviceLoadCell() puts savedTareOffset back when it lands.
+   tareRestorePending = true;
+   #endif
+}
+
+//************************************************************************************
+// Start collecting a fresh set of samples (for a tare or a calibration reading)
+//************************************************************************************
+void startDataSet() {
+   #ifdef HX711_ISR_MODE
+   loadCell.restartDataSet();
+   #else
+   dataSetCount = 0;
+   #endif
+}
+
+//************************************************************************************
+// True once the averaging window is all samples from after startDataSet()
+//************************************************************************************
+bool dataSetReady() {
+   #ifdef HX711_ISR_MODE
+   return loadCell.getDataSetStatus();
+   #else
+   return dataSetCount >= loadCell.getSamplesInUse();
+   #endif
+}
+
+//************************************************************************************
+// How far along the fresh data set is, 0-99%.  100% is left for when the caller is done.
+//************************************************************************************
+uint8_t dataSetPercent() {
+   #ifdef HX711_ISR_MODE
+   uint16_t count = loadCell.getDataSetCount();
+   #else
+   uint16_t count = dataSetCount;
+   #endif
+   uint16_t percent = count * 100 / loadCell.getSamplesInUse();
+   return percent > 99 ? 99 : percent;
+}
+
+//************************************************************************************
+// Show a progress percentage on the last row of a message.  Only redraws on change.
+//************************************************************************************
+void displayProgress(uint8_t percent) {
+   if(percent != shownProgress) {
+      oled.clearField(0,rowsPerChar*3,10);
+      oled.print(percent);
+      oled.print('%');
+      shownProgress = percent;
+   }
 }
 
 //************************************************************************************
@@ -622,33 +1355,35 @@ void rezero() {
 //************************************************************************************
 void enterKnownWeight() {
    boolean returnFlag = false;
-   float lastWeight;
+   decimal_t lastWeight = calRefWeight - DECIMAL_ONE;  // Anything different so the first pass draws the value
    displayMessage("Rotate and\nClick To\nSet Ref",0);
    while(!returnFlag) {
-      value += encoder->getValue();
+      serviceLoadCell();  // Keep measuring while we wait on the user
+      value += encoder.getValue();
       if (value != last) {
          if(value > last) { 
-            calRefWeight+=.01;   // Increase reference weight
+            calRefWeight+=DECIMAL_HUNDREDTH;   // Increase reference weight
          }else{
-            calRefWeight-=.01;   // Reduce the reference weight
+            calRefWeight-=DECIMAL_HUNDREDTH;   // Reduce the reference weight
          }
          last = value;
       }
 
       // Update the display with new value if it has changed
-      if(abs(calRefWeight-lastWeight) >= .001) {
+      if(calRefWeight != lastWeight) {
          oled.clearField(col,rowsPerChar*3,10);
-         oled.print(calRefWeight);
+         printDecimal(oled, calRefWeight);
          oled.print(" lbs");
+         oled.flush();
          lastWeight=calRefWeight;
       }
+      serviceDisplay();
 
       // Go see if they clicked to confirm
-      ClickEncoder::Button button = encoder->getButton();
-      if (button != ClickEncoder::Open) {
+      KnobButton button = encoder.getButton();
+      if (button != KNOB_OPEN) {
          switch (button) {
-            case ClickEncoder::Clicked:
-               sp--;
+            case KNOB_CLICKED:
                dispUpdateNeeded = true;
                returnFlag=true;
                break;
@@ -664,27 +1399,84 @@ void enterKnownWeight() {
 // Run the calibration code.  Creates a new scale calibration constant
 //************************************************************************************
 void calibrate() {
+   savedCalVal = calVal;
+   savedTareOffset = loadCell.getTareOffset();
    displayMessage("Remove Any\nWeight on\nScale then\nclick",0);
-   waitForClick();
+   calState = CAL_WAIT_EMPTY;
+}
 
-   displayMessage("Resetting\ncalVal\nFactor...",0);
+//************************************************************************************
+// One step of the calibration.  Called from loop() until it's done or the user
+// double-clicks to cancel it.
+//************************************************************************************
+void serviceCalibration(KnobButton button) {
+   if(button == KNOB_DOUBLE_CLICKED && calState != CAL_SHOW_RESULT) {
+      if(calState == CAL_ZEROING) {
+         cancelTare();
+      }
+      calVal = savedCalVal;
+      loadCell.setCalFactor(calVal);
+      loadCell.setTareOffset(savedTareOffset);
+      endCalibration();
+      return;
+   }
 
-   loadCell.begin();
-   loadCell.start(2000, true);    // Start the ADC, wait a few seconds then get zero out the reading.
-   loadCell.setCalFactor(1.0);    // Calibration value (float).  Library uses 1.0 as an initial starting point.
-   while (!loadCell.update());    // Make sure we aren't in the middle of a read
+   switch(calState) {
+      case CAL_WAIT_EMPTY:
+         if(button == KNOB_CLICKED) {
+            displayMessage("Resetting\ncalVal\nFactor...",0);
+            loadCell.setCalFactor(DECIMAL_ONE);    // Calibration value.  Library uses 1.0 as an initial starting point.
+            startTare();
+            calState = CAL_ZEROING;
+         }
+         break;
+
+      case CAL_ZEROING:
+         if(loadCell.getTareStatus()) {
+            displayMessage("Place Ref\nWeight On\nScale Then\nclick",0);
+            calState = CAL_WAIT_REF;
+         } else {
+            displayProgress(dataSetPercent());
+         }
+         break;
+
+      case CAL_WAIT_REF:
+         if(button == KNOB_CLICKED) {
+            displayMessage("Calibrating",0);
+            startDataSet();   // Make sure the known mass is all that gets measured
+            shownProgress = NO_PROGRESS;
+            calState = CAL_MEASURING;
+         }
+         break;
+
+      case CAL_MEASURING:
+         if(dataSetReady()) {
+            calVal = loadCell.getNewCalibration(calRefWeight); //get the new calibration value
+            traceSettings();
+            displayMessage("Calibrating\nNew calVal",0);
+            printDecimal(oled, calVal);
+            oled.println();
+            calResultTime = millis();
+            calState = CAL_SHOW_RESULT;
+         } else {
+            displayProgress(dataSetPercent());
+         }
+         break;
 
-   displayMessage("Place Ref\nWeight On\nScale Then\nclick",0);
-   waitForClick();
+      case CAL_SHOW_RESULT:
+         if(button == KNOB_CLICKED || millis() - calResultTime >= CAL_RESULT_TIME) {
+            endCalibration();
+         }
+         break;
 
-   displayMessage("Calibrating",0);
-   loadCell.update();
-   loadCell.refreshDataSet(); //refresh the dataset to be sure that the known mass is measured correct
-   calVal = loadCell.getNewCalibration(calRefWeight); //get the new calibration value
-   oled.println("\nNew calVal");
-   oled.println(calVal);
-   delay(2000);
-   sp--;
+      default:
+         break;
+   }
+}
+
+void endCalibration() {
+   calState = CAL_IDLE;
+   dispUpdateNeeded = true;
 }
 
 //************************************************************************************
@@ -695,35 +1487,41 @@ void calibrate() {
 //************************************************************************************
 void editCal() {
    boolean returnFlag = false;
-   float lastCalVal;
    displayMessage("Rotate and\nClick To\nEdit calVal",0);
 
    // Round off existing calVal to look nicer in display...
+   #ifdef FLOAT_WEIGHT_MATH
    calVal=round(calVal) * 1.0;
+   #else
+   calVal=(calVal >= 0 ? calVal + DECIMAL_ONE/2 : calVal - DECIMAL_ONE/2) / DECIMAL_ONE * DECIMAL_ONE;
+   #endif
+   decimal_t lastCalVal = calVal - DECIMAL_ONE;   // Anything different so the first pass draws the value
    while(!returnFlag) {
-      value += encoder->getValue();
+      serviceLoadCell();  // Keep measuring while we wait on the user
+      value += encoder.getValue();
       if (value != last) {
          if(value > last) { 
-            calVal+=1.0;   // Increase the calibration value
+            calVal+=DECIMAL_ONE;   // Increase the calibration value
          }else{
-            calVal-=1.0;   // Reduce the calibration value
+            calVal-=DECIMAL_ONE;   // Reduce the calibration value
          }
          last = value;
       }
 
       // Update the display with new value if it has changed
-      if(abs(calVal-lastCalVal) >= .1) {
+      if(calVal != lastCalVal) {
          oled.clearField(col,rowsPerChar*3,10);
-         oled.print(calVal);
+         printDecimal(oled, calVal);
+         oled.flush();
          lastCalVal=calVal;
       }
+      serviceDisplay();
 
       // Go see if they clicked to confirm
-      ClickEncoder::Button button = encoder->getButton();
-      if (button != ClickEncoder::Open) {
+      KnobButton button = encoder.getButton();
+      if (button != KNOB_OPEN) {
          switch (button) {
-            case ClickEncoder::Clicked:
-               sp--;
+            case KNOB_CLICKED:
                dispUpdateNeeded = true;
                returnFlag=true;
                break;
@@ -738,40 +1536,155 @@ void editCal() {
 // Save the calibration constant to EEPROM
 //************************************************************************************
 void saveCal() {
-   EEPROM.put(calVal_eepromAdress, calVal);
+   eepromPutDecimal(LOG_CAL_VAL, calVal);
    displayMessage("Saving",0);
-   oled.println(calVal);
+   printDecimal(oled, calVal);
+   oled.println();
    oled.println("to EEPROM");
-   delay(2000);
-   sp--;
+   acquisitionDelay(2000);
 }
 
 //************************************************************************************
-// Clear the OLED and display the message for delayVal length of time
+// Read the battery again and stay in the menu, where the item shows it
 //************************************************************************************
-void displayMessage(const char * str, int delayVal) {
-   oled.clear();
-   oled.set2X();
-   oled.println(str);
-   delay(delayVal);
+void checkBattery() {
+   readBattery();
 }
 
+#ifdef DISPLAY_BENCHMARK
 //************************************************************************************
-// Wait for a click to proceed
-// Used when waiting for the user to respond to a menu request
+// Time the panel on each way of driving it (see OledBus.h).  A full-screen repaint is
+// what a menu cost before the shadow display: clear, then 4 rows of 10 2X characters.
+// A single field is one weight, 6 2X characters.  This goes straight to the panel,
+// around the queue and the shadow, so it's the bus and nothing else.  The results go
+// on the screen and the serial port, and a click goes back to the menu.
 //************************************************************************************
-void waitForClick() {
-   boolean returnFlag = false;
-   ClickEncoder::Button btn;
-   while(!returnFlag) {
-      btn = encoder->getButton();
-      delay(500); // Encoder lib seems to need some delay between reading the button testing result
-      if (btn != ClickEncoder::Open) {
-         if(btn == ClickEncoder::Clicked) {
-            returnFlag=true;
+const uint8_t BENCH_FULL_FRAMES = 4;
+const uint8_t BENCH_FIELD_FRAMES = 16;
+const uint8_t BENCH_MAX_SETTINGS = 4;
+
+// us as ms, with one or two decimals
+void printBenchMs(Print &out, unsigned long us, uint8_t decimals) {
+   printFixed(out, us / (decimals == 2 ? 10 : 100), decimals);
+}
+
+void displayBenchmark() {
+   const __FlashStringHelper *names[BENCH_MAX_SETTINGS];
+   unsigned long fullUs[BENCH_MAX_SETTINGS];
+   unsigned long fieldUs[BENCH_MAX_SETTINGS];
+   uint8_t settings = panel.busSettings();
+   if(settings > BENCH_MAX_SETTINGS) {
+      settings = BENCH_MAX_SETTINGS;
+   }
+
+   displayMessage("Timing\nDisplay...",0);
+   oled.drain();   // Nothing of ours left to send in the middle of it
+
+   for(uint8_t s = 0; s < settings; s++) {
+      names[s] = panel.useBusSetting(s);
+      panel.set2X();
+      unsigned long start = micros();
+      for(uint8_t frame = 0; frame < BENCH_FULL_FRAMES; frame++) {
+         panel.clear();
+         for(uint8_t row = 0; row < 4; row++) {
+            panel.setCursor(0, row * 2);
+            for(uint8_t c = 0; c < 10; c++) {
+               panel.write('0' + (frame + row + c) % 10);
+            }
          }
       }
+      fullUs[s] = (micros() - start) / BENCH_FULL_FRAMES;
+      serviceLoadCell();
+
+      start = micros();
+      for(uint8_t frame = 0; frame < BENCH_FIELD_FRAMES; frame++) {
+         panel.setCursor(0, 0);
+         for(uint8_t c = 0; c < WEIGHT_FIELD_WIDTH; c++) {
+            panel.write('0' + (frame + c) % 10);
+         }
+      }
+      fieldUs[s] = (micros() - start) / BENCH_FIELD_FRAMES;
+      serviceLoadCell();
    }
+   oled.begin();   // Back on the configured bus, and the shadow starts again from a blank panel
+
+   oled.set1X();
+   oled.setCursor(0, 0);
+   oled.print(F("bus"));
+   oled.setCursor(60, 0);
+   oled.print(F("full"));
+   oled.setCursor(96, 0);
+   oled.print(F("field"));
+   for(uint8_t s = 0; s < settings; s++) {
+      oled.drain();   // A line at a time, the whole screen is more than the display queue holds
+      oled.setCursor(0, s + 2);
+      oled.print(names[s]);
+      oled.setCursor(60, s + 2);
+      printBenchMs(oled, fullUs[s], 1);
+      oled.setCursor(96, s + 2);
+      printBenchMs(oled, fieldUs[s], 2);
+
+      Serial.print(F("display bench "));
+      Serial.print(names[s]);
+      Serial.print(F(": full "));
+      Serial.print(fullUs[s]);
+      Serial.print(F(" us, field "));
+      Serial.print(fieldUs[s]);
+      Serial.println(F(" us"));
+   }
+   oled.drain();
+   oled.setCursor(0, 7);
+   oled.print(F("ms, click to exit"));
+   waitForClickOrDoubleClick();
+   dispUpdateNeeded = true;
+}
+#endif
+
+#ifdef MEMORY_STATS
+//************************************************************************************
+// Where the RAM is going (see MemoryStats.h), on the panel and the serial port, until
+// they click.  "least free" is how close the stack has come to the heap since power on.
+//************************************************************************************
+static void showMemoryLine(uint8_t row, const __FlashStringHelper *label, uint16_t bytes) {
+   oled.drain();   // A line at a time, the whole screen is more than the display queue holds
+   oled.setCursor(0, row);
+   oled.print(label);
+   oled.setCursor(oled.fieldWidth(11), row);
+   printFixed(oled, bytes, 0, 5);
+}
+
+void displayMemoryStats() {
+   MemoryStats stats;
+   oled.clear();
+   oled.set1X();
+   if(readMemoryStats(stats)) {
+      showMemoryLine(0, F("RAM"), stats.total);
+      showMemoryLine(1, F("static"), stats.staticRam);
+      showMemoryLine(2, F("heap"), stats.heap);
+      showMemoryLine(3, F("stack"), stats.stack);
+      showMemoryLine(4, F("stack peak"), stats.stackPeak);
+      showMemoryLine(5, F("free"), stats.free);
+      showMemoryLine(6, F("least free"), stats.leastFree);
+   } else {
+      oled.print(F("No RAM figures here"));
+   }
+   reportMemory(Serial);
+   oled.drain();
+   oled.setCursor(0, 7);
+   oled.print(F("click to exit"));
+   waitForClickOrDoubleClick();
+   dispUpdateNeeded = true;
+}
+#endif
+
+//************************************************************************************
+// Clear the OLED and display the message for delayVal length of time
+//************************************************************************************
+void displayMessage(const char * str, int delayVal) {
+   oled.clear();
+   oled.set2X();
+   oled.println(str);
+   acquisitionDelay(delayVal);
 }
 
 //************************************************************************************
@@ -781,20 +1694,250 @@ void waitForClick() {
 int waitForClickOrDoubleClick() {
    boolean returnFlag = false;
    int returnResult;
-   ClickEncoder::Button btn;
+   KnobButton btn;
    while(!returnFlag) {
-      btn = encoder->getButton();
-      delay(500); // Encoder lib seems to need some delay between reading the button testing result
-      if (btn != ClickEncoder::Open) {
-         if(btn == ClickEncoder::Clicked) {
+      btn = encoder.getButton();
+      acquisitionDelay(500); // Encoder lib seems to need some delay between reading the button testing result
+      if (btn != KNOB_OPEN) {
+         if(btn == KNOB_CLICKED) {
             returnResult=1;
             returnFlag=true;
          }
-         if(btn == ClickEncoder::DoubleClicked) {
+         if(btn == KNOB_DOUBLE_CLICKED) {
             returnResult=2;
             returnFlag=true;
          }
       }
    }
    return(returnResult);
-}
\ No newline at end of file
+}
+
+//************************************************************************************
+// Delay that keeps the load cell serviced
+// Used in place of delay() anywhere the UI has to wait so we keep up with the HX711
+// conversions instead of letting them pile up (or get dropped) behind the UI.
+//************************************************************************************
+void acquisitionDelay(unsigned long delayVal) {
+   oled.flush();   // Whatever was drawn before the wait has to be up for it
+   unsigned long startTime = millis();
+   do {
+      serviceLoadCell();
+      serviceDisplay();
+   } while(millis() - startTime < delayVal);
+}
+
+//************************************************************************************
+// One slice of display sending.  From the scheduler, and from anywhere that waits in
+// a loop of its own.
+//************************************************************************************
+void serviceDisplay() {
+   PROFILE_BEGIN(PROFILE_DISPLAY);
+   oled.service(DISPLAY_SLICE_US);
+   PROFILE_END(PROFILE_DISPLAY);
+}
+
+//************************************************************************************
+// Go measure the object sitting on the scale
+// Reads the load cell every readInterval and runs the reading through the stability
+// detector.  Called from loop() and from anywhere the UI blocks.
+//************************************************************************************
+void serviceLoadCell() {
+   PROFILE_BEGIN(PROFILE_LOAD_CELL);
+   #if defined(HIGH_RATE_MODE) && defined(HX711_ISR_MODE)
+   loadCell.update();   // Hands each conversion to processSample()
+   #else
+   uint8_t newData = loadCell.update();
+   #endif
+   PROFILE_END(PROFILE_LOAD_CELL);
+
+   #ifndef HX711_ISR_MODE
+   if(newData) {
+      dataSetCount++;
+   }
+   // A cancelled tare still lands in the library.  Put the old zero back before anyone reads it.
+   if(tareRestorePending && loadCell.getTareStatus()) {
+      loadCell.setTareOffset(savedTareOffset);
+      tareRestorePending = false;
+   }
+   #endif
+
+   #ifdef HIGH_RATE_MODE
+   #ifndef HX711_ISR_MODE
+   if(newData) {
+      processSample(loadCell.getData(), millis());
+   }
+   #endif
+   #else
+   static boolean newDataReady = 0;
+
+   if(newData) {
+      newDataReady = true;
+   }
+   if(newDataReady && calState == CAL_IDLE) {   // Not weights while calibrating, see processSample()
+      if(millis() - adc_read_time >= readInterval) {
+
+         // Read the HX711 to the latest measurment
+         weight_t reading = loadCell.getData();
+         handleStabilityEvent(stability.update(weightToQ16(reading), millis()));
+
+         // Hold the settled value while stable so the last digit doesn't wander
+         pounds = stability.isStable() ? stablePounds : reading;
+         kilograms = poundsToKilograms(pounds);
+         newDataReady = 0;
+         adc_read_time = millis();
+      }
+   }
+   #endif
+
+   #ifdef HX711_ISR_MODE
+   // Let the serial monitor know if the main loop ever fell far enough behind to lose conversions
+   static uint16_t reportedOverruns = 0;
+   uint16_t overruns = loadCell.getOverruns();
+   if(overruns != reportedOverruns) {
+      Serial.print(F("HX711 overruns: "));
+      Serial.print(overruns);
+      Serial.print(F(" of "));
+      Serial.println(loadCell.getSamplesCaptured());
+      reportedOverruns = overruns;
+   }
+   #endif
+}
+
+//************************************************************************************
+// Stable/moving events.  Latch the settled weight and let the serial port know.
+//************************************************************************************
+void handleStabilityEvent(StabilityEvent event) {
+   switch(event) {
+      case STABILITY_BECAME_STABLE:
+         stablePounds = q16ToWeight(stability.mean());
+         Serial.print(F("STABLE "));
+         printDecimal(Serial, weightToDecimal(stablePounds));
+         Serial.print(F(" lbs  peak "));
+         printDecimal(Serial, weightToDecimal(peakPounds));
+         Serial.println(F(" lbs"));
+         break;
+      case STABILITY_BECAME_UNSTABLE:
+         Serial.println(F("MOVING"));
+         #ifdef ADAPTIVE_REFRESH
+         if(sp == 0) {
+            setRefresh(REFRESH_MOVING);   // Show the new load coming on without waiting out the slow period
+         }
+         #endif
+         break;
+      default:
+         break;
+   }
+}
+
+#ifdef HIGH_RATE_MODE
+//************************************************************************************
+// Every HX711 conversion comes through here in HIGH_RATE_MODE
+// The stability detector and the sample consumers get every conversion.  The display
+// gets the average of each HIGH_RATE_DECIMATION conversions, 10 readings a second.
+// Not while calibrating: the load cell is on a cal factor of 1.00 then, so these
+// aren't weights (full-scale counts are pinned at the top of the range) and nothing
+// should latch them as a stable weight or a peak.
+//************************************************************************************
+void processSample(weight_t weight, uint32_t time) {
+   if(calState != CAL_IDLE) {
+      return;
+   }
+   handleStabilityEvent(stability.update(weightToQ16(weight), time));
+
+   decimationSum += weight;
+   decimationCount++;
+   if(decimationCount >= HIGH_RATE_DECIMATION) {
+      // Hold the settled value while stable so the last digit doesn't wander
+      pounds = stability.isStable() ? stablePounds : decimationSum / decimationCount;
+      kilograms = poundsToKilograms(pounds);
+      decimationSum = 0;
+      decimationCount = 0;
+   }
+
+   for(uint8_t i = 0; i < numSampleConsumers; i++) {
+      sampleConsumers[i](weight, time);
+   }
+}
+
+//************************************************************************************
+// Register a callback to get every conversion
+//************************************************************************************
+void addSampleConsumer(void (*consumer)(weight_t weight, uint32_t time)) {
+   if(numSampleConsumers < MAX_SAMPLE_CONSUMERS) {
+      sampleConsumers[numSampleConsumers++] = consumer;
+   }
+}
+
+//************************************************************************************
+// Sample consumer - keep the heaviest reading.  At full rate this catches the peak
+// of a load that is dropped or bounced onto the scale, which the display rate misses.
+//************************************************************************************
+void capturePeak(weight_t weight, uint32_t time) {
+   if(weight > peakPounds) {
+      peakPounds = weight;
+   }
+}
+
+//************************************************************************************
+// Sample consumer - print every conversion on the serial port as "ms,pounds"
+//************************************************************************************
+void streamSample(weight_t weight, uint32_t time) {
+   Serial.print(time);
+   Serial.print(',');
+   printDecimal(Serial, weightToDecimal(weight));
+   Serial.println();
+}
+#endif
+
+//************************************************************************************
+// Wait for the weight to settle before storing it
+// Returns true once stable.  Gives up (false) after STORE_STABLE_TIMEOUT_MS or if the
+// user clicks to abort.
+//************************************************************************************
+bool waitForStable() {
+   if(stability.isStable()) {
+      return true;
+   }
+   displayMessage("Waiting\nfor Stable",0);
+   unsigned long startTime = millis();
+   while(!stability.isStable() && millis() - startTime < STORE_STABLE_TIMEOUT_MS) {
+      serviceLoadCell();
+      serviceDisplay();
+      if(encoder.getButton() == KNOB_CLICKED) {
+         break;
+      }
+   }
+   return stability.isStable();
+}
+
+//************************************************************************************
+// Print an x.yy value to the OLED (at the current cursor position) or the serial port.
+// Through NumberFormat.h in both builds, so Print's float formatting isn't used at all.
+//************************************************************************************
+void printDecimal(Print &out, decimal_t val) {
+   printFixed(out, decimalToCenti(val), 2);
+}
+
+//************************************************************************************
+// Read/write an x.yy value in the EEPROM log (ValueLog.h).  Always stored as a float,
+// whichever math the build uses, so switching builds keeps the calibration and stored
+// weights.
+//************************************************************************************
+void eepromGetDecimal(uint8_t key, decimal_t &val) {
+   uint32_t bits = ValueLog::read(key);
+   #ifdef FLOAT_WEIGHT_MATH
+   memcpy(&val, &bits, sizeof(val));
+   #else
+   val = centiFromFloatBits(bits);
+   #endif
+}
+
+void eepromPutDecimal(uint8_t key, decimal_t val) {
+   #ifdef FLOAT_WEIGHT_MATH
+   uint32_t bits;
+   memcpy(&bits, &val, sizeof(bits));
+   ValueLog::write(key, bits);
+   #else
+   ValueLog::write(key, floatBitsFromCenti(val));
+   #endif
+}
@@ -0,0 +1,105 @@
+# Flash taken by the number formatting code, printed after every Nano link.
+#
+# benchmarkNumberFormat() (src/Benchmarks.cpp) times printFixed() against Print's float and integer
+# paths on the scale.  The other half of that comparison is flash, which the running scale can't see,
+# so this reads it from the linker's map file.  Everything is built with -ffunction-sections and linked
+# with --gc-sections, so a function that's in the map is one something calls, and its size is what the
+# build would lose without it.  It comes out after the link as (sizes in bytes):
+#
+#   Number formatting flash (fivekg):
+#      printFixed() / formatFixed()         ...
+#      Print::printNumber()                 ...
+#      Print::printFloat()                    0  (not linked)
+#      vfprintf (sprintf etc.)                0  (not linked)
+#      soft-float library                   ...  (shared by anything else using float)
+#
+# The fixed-point build only needs printFixed() to show a weight.  Print::printFloat() and the float
+# routines come back with RUN_BENCHMARKS (the benchmark calls it) or FLOAT_WEIGHT_MATH.  Hooked in
+# from platformio.ini (extra_scripts), or by hand on any map file:
+#
+#   python tools/flash_report.py .pio/build/fivekg/firmware.map
+
+import os
+import re
+import sys
+
+# " .text._ZN5Print10printFloatEdh  0x00000abc  0x1a6 .pio/build/fivekg/.../Print.cpp.o", or split after the name
+INPUT_SECTION = re.compile(r"^ (\S+)\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+SECTION_NAME_ONLY = re.compile(r"^ (\S+)$")
+SECTION_REST = re.compile(r"^\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+# What's counted, by input section name (the mangled function) or the object file it came from
+GROUPS = (
+    ("printFixed() / formatFixed()", lambda name, path: "printFixed" in name or "formatFixed" in name, ""),
+    ("Print::printNumber()", lambda name, path: "Print11printNumber" in name, ""),
+    ("Print::printFloat()", lambda name, path: "Print10printFloat" in name, ""),
+    ("vfprintf (sprintf etc.)", lambda name, path: re.search(r"\(vfprintf[^)]*\)$", path) is not None, ""),
+    ("soft-float library", lambda name, path: "fplib" in name or "libm.a(" in path,
+     "  (shared by anything else using float)"),
+)
+
+
+def read_text_sections(map_path):
+    """(input section name, size, object path) for everything linked into .text"""
+    sections = []
+    in_text = False
+    pending_name = None
+    with open(map_path) as map_file:
+        for line in map_file:
+            line = line.rstrip("\n")
+            if line and not line[0].isspace():
+                in_text = line.split()[0] == ".text"
+                pending_name = None
+                continue
+            if not in_text:
+                continue
+
+            size = path = None
+            match = INPUT_SECTION.match(line)
+            if match:
+                name, size, path = match.groups()
+            elif pending_name:
+                match = SECTION_REST.match(line)
+                if match:
+                    name = pending_name
+                    size, path = match.groups()
+            pending_name = None
+            if size is None:
+                match = SECTION_NAME_ONLY.match(line)
+                if match:
+                    pending_name = match.group(1)
+                continue
+            if name == "*fill*":
+                continue
+
+            size = int(size, 16)
+            if size:
+                sections.append((name, size, path.strip()))
+    return sections
+
+
+def print_report(map_path, title):
+    sections = read_text_sections(map_path)
+    print("Number formatting flash (%s):" % title)
+    for label, matches, note in GROUPS:
+        total = sum(size for name, size, path in sections if matches(name, path))
+        print("   %-34s%6d%s" % (label, total, note if total else "  (not linked)"))
+
+
+try:
+    Import("env")  # noqa: F821 - PlatformIO's SCons provides it
+except NameError:
+    env = None
+
+if env is not None:
+    if env.subst("$PIOPLATFORM") == "atmelavr":
+        map_path = os.path.join(env.subst("$BUILD_DIR"), env.subst("${PROGNAME}.map"))
+        map_flag = "-Wl,-Map," + map_path
+        if map_flag not in env.get("LINKFLAGS", []):   # tools/ram_report.py may have asked for it already
+            env.Append(LINKFLAGS=[map_flag])
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf",
+                          lambda target, source, env: print_report(map_path, env.subst("$PIOENV")))
+elif __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.exit("usage: flash_report.py firmware.map")
+    print_report(sys.argv[1], os.path.basename(sys.argv[1]))
@@ -0,0 +1,101 @@
+# Static RAM by module, printed after every Nano link.
+#
+# The linker's map file says which object file each piece of .data, .bss and .noinit came from,
+# after --gc-sections has thrown out what isn't used.  This adds those up per file (a library's
+# archive members by their own names) so each build environment shows where its static RAM goes:
+#
+#   RAM by module (fivekg): 1355 of 2048 bytes static
+#      main.cpp.o                  612  (data 36, bss 576)
+#      HardwareSerial0.cpp.o       157  (data 0, bss 157)
+#      ...
+#
+# The stack and heap come out of what's left, see include/MemoryStats.h for measuring those on the
+# running scale.  Hooked in from platformio.ini (extra_scripts), or by hand on any map file:
+#
+#   python tools/ram_report.py .pio/build/fivekg/firmware.map [ram bytes]
+
+import os
+import re
+import sys
+
+RAM_SECTIONS = (".data", ".bss", ".noinit")
+
+# " .bss.storeArr  0x00800234  0x28 .pio/build/nano/src/main.cpp.o", or split after the name
+INPUT_SECTION = re.compile(r"^ (\S+)\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+SECTION_NAME_ONLY = re.compile(r"^ (\S+)$")
+SECTION_REST = re.compile(r"^\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+
+def module_name(path):
+    archive_member = re.search(r"\(([^()]+)\)$", path)
+    if archive_member:
+        return archive_member.group(1)
+    return os.path.basename(path)
+
+
+def read_map(map_path):
+    """Bytes per module, split by output section: {module: {".data": n, ".bss": n}}"""
+    modules = {}
+    output_section = None
+    pending_name = None
+    with open(map_path) as map_file:
+        for line in map_file:
+            line = line.rstrip("\n")
+            if line and not line[0].isspace():
+                name = line.split()[0]
+                output_section = name if name in RAM_SECTIONS else None
+                pending_name = None
+                continue
+            if output_section is None:
+                continue
+
+            size = path = None
+            match = INPUT_SECTION.match(line)
+            if match:
+                name, size, path = match.groups()
+            elif pending_name:
+                match = SECTION_REST.match(line)
+                if match:
+                    name = pending_name
+                    size, path = match.groups()
+            pending_name = None
+            if size is None:
+                match = SECTION_NAME_ONLY.match(line)
+                if match:
+                    pending_name = match.group(1)
+                continue
+            if name == "*fill*":
+                continue
+
+            size = int(size, 16)
+            if size:
+                sections = modules.setdefault(module_name(path.strip()), {})
+                sections[output_section] = sections.get(output_section, 0) + size
+    return modules
+
+
+def print_report(map_path, ram_size, title):
+    modules = read_map(map_path)
+    total = sum(sum(sections.values()) for sections in modules.values())
+    print("RAM by module (%s): %d of %d bytes static" % (title, total, ram_size))
+    for module, sections in sorted(modules.items(), key=lambda m: -sum(m[1].values())):
+        print("   %-28s%5d  (data %d, bss %d)" % (module, sum(sections.values()),
+              sections.get(".data", 0), sections.get(".bss", 0) + sections.get(".noinit", 0)))
+
+
+try:
+    Import("env")  # noqa: F821 - PlatformIO's SCons provides it
+except NameError:
+    env = None
+
+if env is not None:
+    if env.subst("$PIOPLATFORM") == "atmelavr":
+        map_path = os.path.join(env.subst("$BUILD_DIR"), env.subst("${PROGNAME}.map"))
+        env.Append(LINKFLAGS=["-Wl,-Map," + map_path])
+        ram_size = int(env.BoardConfig().get("upload.maximum_ram_size", 2048))
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf",
+                          lambda target, source, env: print_report(map_path, ram_size, env.subst("$PIOENV")))
+elif __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.exit("usage: ram_report.py firmware.map [ram bytes]")
+    print_report(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else 2048, os.path.basename(sys.argv[1]))